@@ -36,6 +36,8 @@ static const char rcsid[] = "$Id: d_main.c,v 1.54 1998/10/04 13:20:32 thldrmn Ex
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <process.h>
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -64,6 +66,7 @@ static const char rcsid[] = "$Id: d_main.c,v 1.54 1998/10/04 13:20:32 thldrmn Ex
 #include "d_main.h"
 #include "d_deh.h"  // Ty 04/08/98 - Externalizations
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
+#include "m_vidcap.h"
 
 // DEHacked support - Ty 03/09/97
 void ProcessDehFile(char *filename, char *outfilename);
@@ -172,6 +175,31 @@ extern boolean setsizeneeded;
 extern int     showMessages;
 void           R_ExecuteSetViewSize(void);
 
+// A wipe is carried on a step each frame, while tics go on being run,
+// the network serviced and sound updated, instead of D_Display looping
+// until it is done. The game is not drawn until the wipe is over.
+
+static boolean wiping;            // a wipe is going on
+static int     wipestart;         // time of its last step
+
+static void D_WipeStep(void)
+{
+  int nowtime = I_GetTime(), tics = nowtime - wipestart;
+
+  if (singletics)                   // each frame is a tic
+    tics = 1;
+
+  if (tics > 0)
+    {
+      wipestart = nowtime;
+      if (wipe_ScreenWipe(wipe_Melt,0,0,SCREENWIDTH,SCREENHEIGHT,tics))
+        wiping = false;
+    }
+  I_UpdateNoBlit();
+  M_Drawer();                       // menu is drawn even on top of wipes
+  I_FinishUpdate();                 // page flip or blit buffer
+}
+
 void D_Display (void)
 {
   static boolean viewactivestate = false;
@@ -180,12 +208,23 @@ void D_Display (void)
   static boolean fullscreen = false;
   static gamestate_t oldgamestate = -1;
   static int borderdrawcount;
-  int wipestart;
-  boolean done, wipe, redrawsbar;
+  boolean wipe, redrawsbar;
 
   if (nodrawers)                    // for comparative timing / profiling
     return;
 
+  if (wiping)
+    {
+      if (gamestate == wipegamestate)
+        {
+          D_WipeStep();
+          return;
+        }
+      // the state changed again: wipe from what is on the screen now
+      wipe_StopScreenWipe(wipe_Melt, SCREENWIDTH, SCREENHEIGHT);
+      wiping = false;
+    }
+
   redrawsbar = false;
 
   if (setsizeneeded)                // change the view size if needed
@@ -285,27 +324,12 @@ void D_Display (void)
       return;
     }
 
-  // wipe update
+  // wipe update, the first step now and the rest in later frames
   wipe_EndScreen(0, 0, SCREENWIDTH, SCREENHEIGHT);
 
+  wiping = true;
   wipestart = I_GetTime () - 1;
-
-  do
-    {
-      int nowtime, tics;
-      do
-        {
-          nowtime = I_GetTime();
-          tics = nowtime - wipestart;
-        }
-      while (!tics);
-      wipestart = nowtime;
-      done = wipe_ScreenWipe(wipe_Melt,0,0,SCREENWIDTH,SCREENHEIGHT,tics);
-      I_UpdateNoBlit();
-      M_Drawer();                   // menu is drawn even on top of wipes
-      I_FinishUpdate();             // page flip or blit buffer
-    }
-  while (!done);
+  D_WipeStep();
 }
 
 //
@@ -358,7 +382,16 @@ static void D_DoomLoop(void)
           maketic++;
         }
       else
-        TryRunTics (); // will run at least one tic
+        {
+          TryRunTics (); // will run at least one tic, unless uncapped
+
+          // pick up mouse motion for the view between tics
+          if (uncapped_framerate)
+            {
+              I_StartTic ();
+              D_ProcessEvents ();
+            }
+        }
 
       // killough 3/16/98: change consoleplayer to displayplayer
       S_UpdateSounds(players[displayplayer].mo);// move positional sounds
@@ -366,6 +399,9 @@ static void D_DoomLoop(void)
       // Update display, next frame, with current state.
       D_Display();
 
+      // Encode some of any screenshots waiting to be written
+      M_WriteScreenShots();
+
 #ifndef SNDSERV
       // Sound mixing for the buffer is snychronous.
       I_UpdateSound();
@@ -1249,6 +1285,204 @@ void DoLooseFiles(void)
   myargc = tmyargc;
 }
 
+//
+// Demo verification
+//
+// -verifydemos <demo|@listfile|directory>... plays each demo through
+// G_Ticker alone, without drawing or sound, and writes a line about how
+// it ended to the -verifyreport file (VERIFY.TXT by default), followed by
+// a summary. See G_VerifyDemo.
+//
+// With -verifyjobs <n>, the demos are dealt out among n copies of BOOM,
+// each given -verifyslice <k> <n> and writing its own report, which are
+// then merged in order. DOS runs the copies one after another, but each
+// copy starts afresh, and one which stops with an error only loses the
+// rest of its own slice, whose demos are reported as failed.
+//
+
+#define MAXVERIFYJOBS 16
+
+static char **verifylist;
+static int numverify, maxverify;
+
+static void D_AddVerifyDemo(const char *name)
+{
+  if (numverify >= maxverify)
+    verifylist = realloc(verifylist,
+                   (maxverify = maxverify ? maxverify*2 : 64) * sizeof *verifylist);
+  verifylist[numverify++] = strdup(name);
+}
+
+static int D_CompareNames(const void *a, const void *b)
+{
+  return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static void D_AddVerifyDemos(const char *arg)
+{
+  struct stat st;
+
+  if (*arg == '@')                          // list file, one demo a line
+    {
+      char line[PATH_MAX+1];
+      FILE *f = fopen(arg+1, "r");
+      if (!f)
+        I_Error("Couldn't read demo list %s", arg+1);
+      while (fgets(line, sizeof line, f))
+        {
+          char *end = line + strlen(line);
+          while (end > line && isspace(end[-1]))
+            *--end = 0;
+          if (*line)
+            D_AddVerifyDemo(line);
+        }
+      fclose(f);
+    }
+  else
+    if (!stat(arg, &st) && S_ISDIR(st.st_mode)) // every .LMP in directory
+      {
+        DIR *dir = opendir(arg);
+        struct dirent *d;
+        int first = numverify;
+        while (dir && (d = readdir(dir)))
+          {
+            size_t len = strlen(d->d_name);
+            if (len > 4 && !stricmp(d->d_name + len - 4, ".lmp"))
+              {
+                char name[PATH_MAX+1];
+                sprintf(name, "%s/%s", arg, d->d_name);
+                D_AddVerifyDemo(name);
+              }
+          }
+        if (dir)
+          closedir(dir);
+        qsort(verifylist + first, numverify - first,
+              sizeof *verifylist, D_CompareNames);   // same order everywhere
+      }
+    else
+      {
+        char name[PATH_MAX+1];
+        strcpy(name, arg);
+        AddDefaultExtension(name, ".lmp");
+        D_AddVerifyDemo(name);
+      }
+}
+
+// The report of slice k is the report's name with the extension .00k
+
+static void D_SliceReportName(char *name, const char *report, int slice)
+{
+  char *dot;
+  strcpy(name, report);
+  if ((dot = strrchr(name, '.')) && !strpbrk(dot, "/\\"))
+    *dot = 0;
+  sprintf(name + strlen(name), ".%03d", slice);
+}
+
+static void D_VerifyDemos(int p)
+{
+  char line[PATH_MAX+256], report[PATH_MAX+1];
+  int counts[NUMDEMOVERDICTS], slice = 0, slices = 1, jobs = 0, i;
+  int starttime = I_GetTime_RealTime();
+  FILE *out;
+
+  while (++p < myargc && *myargv[p] != '-')
+    D_AddVerifyDemos(myargv[p]);
+
+  strcpy(report, (p = M_CheckParm("-verifyreport")) && p < myargc-1 ?
+         myargv[p+1] : "verify.txt");
+
+  if ((p = M_CheckParm("-verifyslice")) && p < myargc-2)
+    {
+      slice = atoi(myargv[p+1]);
+      slices = atoi(myargv[p+2]);
+      D_SliceReportName(report, report, slice);
+    }
+  else
+    if ((p = M_CheckParm("-verifyjobs")) && p < myargc-1)
+      {
+        jobs = atoi(myargv[p+1]);
+        jobs = jobs < 1 ? 1 : jobs > MAXVERIFYJOBS ? MAXVERIFYJOBS : jobs;
+      }
+
+  if (!(out = fopen(report, "w")))
+    I_Error("Couldn't write %s", report);
+
+  memset(counts, 0, sizeof counts);
+
+  if (jobs)                                 // run the slices, then merge
+    {
+      FILE *in[MAXVERIFYJOBS];
+      char **args = malloc((myargc + 4) * sizeof *args), k[8], n[8];
+
+      memcpy(args, myargv, myargc * sizeof *args);
+      args[myargc] = "-verifyslice";
+      args[myargc+1] = k;
+      args[myargc+2] = n;
+      args[myargc+3] = NULL;
+      sprintf(n, "%d", jobs);
+
+      for (i=0; i<jobs; i++)
+        {
+          char name[PATH_MAX+1];
+          sprintf(k, "%d", i);
+          lprintf(LO_INFO, "Verifying demos, slice %d of %d\n", i+1, jobs);
+          spawnv(P_WAIT, myargv[0], args);
+          D_SliceReportName(name, report, i);
+          in[i] = fopen(name, "r");
+        }
+
+      for (i=0; i<numverify; i++)           // slices were dealt round robin
+        {
+          FILE *f = in[i % jobs];
+          char verdict[16];
+          if (!f || !fgets(line, sizeof line, f) || *line == '#')
+            sprintf(line, "%s %s\n", verifylist[i], demoverdicts[dv_failed]);
+          fputs(line, out);
+          if (sscanf(line, "%*s %15s", verdict) == 1)
+            {
+              int v = 0;
+              while (v < dv_failed && strcmp(verdict, demoverdicts[v]))
+                v++;
+              counts[v]++;
+            }
+        }
+
+      for (i=0; i<jobs; i++)
+        if (in[i])
+          {
+            char name[PATH_MAX+1];
+            fclose(in[i]);
+            D_SliceReportName(name, report, i);
+            remove(name);
+          }
+      free(args);
+    }
+  else
+    for (i=slice; i<numverify; i+=slices)
+      {
+        counts[G_VerifyDemo(verifylist[i], line)]++;
+        fprintf(out, "%s\n", line);
+        fflush(out);                        // keep it if a later demo fails
+      }
+
+  if (slices == 1)                          // slices leave this to the merge
+    {
+      fprintf(out, "# %d demos in %d realtics:", numverify,
+              I_GetTime_RealTime() - starttime);
+      for (i=0; i<NUMDEMOVERDICTS; i++)
+        fprintf(out, " %d %s", counts[i], demoverdicts[i]);
+      fprintf(out, "\n");
+      lprintf(LO_INFO, "%d demos verified, %d exit, %d death, %d ingame, "
+              "%d missing, %d failed; see %s\n", numverify, counts[dv_exit],
+              counts[dv_death], counts[dv_ingame], counts[dv_missing],
+              counts[dv_failed], report);
+    }
+  fclose(out);
+
+  exit(counts[dv_missing] || counts[dv_failed]);
+}
+
 //
 // D_DoomMain
 //
@@ -1504,13 +1738,14 @@ void D_DoomMain(void)
   //jff 1/22/98 add command line parms to disable sound and music
   {
     int nosound = M_CheckParm("-nosound");
+    nosound = nosound || M_CheckParm("-verifydemos");  // sound is no use
     nomusicparm = nosound || M_CheckParm("-nomusic");
     nosfxparm   = nosound || M_CheckParm("-nosfx");
   }
   //jff end of sound/music command line parms
 
   // killough 3/2/98: allow -nodraw -noblit generally
-  nodrawers = M_CheckParm ("-nodraw");
+  nodrawers = M_CheckParm ("-nodraw") || M_CheckParm ("-verifydemos");
   noblit = M_CheckParm ("-noblit");
 
   // jff 4/21/98 allow writing predefined lumps out as a wad
@@ -1627,6 +1862,9 @@ void D_DoomMain(void)
       lprintf (LO_CONFIRM,"External statistics registered.\n");
     }
 
+  if ((p = M_CheckParm("-verifydemos")) && p < myargc-1)
+    D_VerifyDemos(p);                 // never returns
+
   // start the apropriate game based on parms
   if ((p = M_CheckParm("-record")) && p < myargc-1)
     {
@@ -1638,6 +1876,8 @@ void D_DoomMain(void)
   if ((p = M_CheckParm("-playdemo")) && p < myargc-1)
     {
       singledemo = true;              // quit after one demo
+      if ((i = M_CheckParm("-viddump")) && i < myargc-1)
+        M_StartVidCap(myargv[i+1]);   // written out as video and sound
       G_DeferedPlayDemo(myargv[p+1]);
       D_DoomLoop();  // never returns
     }
@@ -712,6 +712,7 @@ int     frameskip[4];
 int     oldnettics;
 
 extern  boolean advancedemo;
+extern  int     uncapped_framerate;
 
 void TryRunTics (void)
 {
@@ -744,6 +745,10 @@ void TryRunTics (void)
         }
     }
     availabletics = lowtic - gametic/ticdup;
+
+    // with uncapped_framerate, draw another frame rather than wait for a tic
+    if (uncapped_framerate && !singletics && availabletics < 1)
+      return;
     
     // decide how many tics to run
     if (realtics < availabletics-1)
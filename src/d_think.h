@@ -67,11 +67,26 @@ typedef actionf_t  think_t;
 
 
 // Doubly linked list of actors.
+//
+// Mobj thinkers are also on the mobj list (see p_tick.h), linked through
+// mprev/mnext, so that walks looking for mobjs do not have to step over
+// all the other thinkers. mprev is NULL for other thinkers, and once a
+// mobj has been removed from the mobj list.
+//
+// The thinkers which are not dormant are on the run list, linked through
+// aprev/anext in the same order as the main list. aprev is NULL while
+// the thinker is dormant.
+
 typedef struct thinker_s
 {
   struct thinker_s*   prev;
   struct thinker_s*   next;
   think_t             function;
+  struct thinker_s*   mprev;      // mobj list links
+  struct thinker_s*   mnext;
+  struct thinker_s*   aprev;      // run list links
+  struct thinker_s*   anext;
+  unsigned            references; // dormant mobjs targeting this thinker
     
 } thinker_t;
 
@@ -38,22 +38,16 @@ static const char rcsid[] = "$Id: f_wipe.c,v 1.3 1998/05/03 22:11:24 killough Ex
 //
 // SCREEN WIPE PACKAGE
 //
+// A wipe is run a step at a time, one step each frame, by D_Display, so
+// the game goes on while it runs. The start and end screens are kept in
+// buffers of their own for as long as the wipe lasts, since screens[2] is
+// used for screenshots in the meantime.
+//
 
-static byte *wipe_scr_start;
+static byte *wipe_scr_start;      // PU_STATIC while a wipe is going on
 static byte *wipe_scr_end;
 static byte *wipe_scr;
-
-static void wipe_shittyColMajorXform(short *array, int width, int height)
-{
-  short *dest = Z_Malloc(width*height*sizeof(short), PU_STATIC, 0);
-  int x, y;
-
-  for(y=0;y<height;y++)
-    for(x=0;x<width;x++)
-      dest[x*height+y] = array[y*width+x];
-  memcpy(array, dest, width*height*sizeof(short));
-  Z_Free(dest);
-}
+static boolean go;                // when zero, no wipe is going on
 
 static int wipe_initColorXForm(int width, int height, int ticks)
 {
@@ -94,11 +88,6 @@ static int wipe_initMelt(int width, int height, int ticks)
   // copy start screen to main screen
   memcpy(wipe_scr, wipe_scr_start, width*height);
 
-  // makes this wipe faster (in theory)
-  // to have stuff in column-major format
-  wipe_shittyColMajorXform((short*)wipe_scr_start, width/2, height);
-  wipe_shittyColMajorXform((short*)wipe_scr_end, width/2, height);
-
   // setup initial column positions (y<0 => not ready to scroll yet)
   y = (int *) Z_Malloc(width*sizeof(int), PU_STATIC, 0);
   y[0] = -(M_Random()%16);
@@ -115,48 +104,45 @@ static int wipe_initMelt(int width, int height, int ticks)
   return 0;
 }
 
+// The columns, two pixels wide, are moved down first, and the screen is
+// then put together a row at a time, from the end screen above the top
+// of each column and the start screen, slid down, below it. Working by
+// rows reads and writes the screens in the order they are laid out in,
+// so they need not be turned column-major first.
+
 static int wipe_doMelt(int width, int height, int ticks)
 {
+  const short *s = (const short *) wipe_scr_start;
+  const short *e = (const short *) wipe_scr_end;
+  short *d = (short *) wipe_scr;
   boolean done = true;
-  int i;
+  int i, row;
 
   width /= 2;
 
   while (ticks--)
     for (i=0;i<width;i++)
       if (y[i]<0)
-        {
-          y[i]++;
-          done = false;
-        }
+        y[i]++;
       else
         if (y[i] < height)
           {
-            short *s, *d;
-            int j, dy, idx;
-
-            dy = (y[i] < 16) ? y[i]+1 : 8;
+            int dy = (y[i] < 16) ? y[i]+1 : 8;
             if (y[i]+dy >= height)
               dy = height - y[i];
-            s = &((short *)wipe_scr_end)[i*height+y[i]];
-            d = &((short *)wipe_scr)[y[i]*width+i];
-            idx = 0;
-            for (j=dy;j;j--)
-              {
-                d[idx] = *(s++);
-                idx += width;
-              }
             y[i] += dy;
-            s = &((short *)wipe_scr_start)[i*height];
-            d = &((short *)wipe_scr)[y[i]*width+i];
-            idx = 0;
-            for (j=height-y[i];j;j--)
-              {
-                d[idx] = *(s++);
-                idx += width;
-              }
-            done = false;
           }
+
+  for (row=0; row<height; row++, d += width, e += width)
+    for (i=0;i<width;i++)
+      {
+        int top = y[i] < 0 ? 0 : y[i];
+        d[i] = row < top ? e[i] : s[(row-top)*width+i];
+      }
+
+  for (i=0;i<width;i++)
+    if (y[i] < height)
+      done = false;
   return done;
 }
 
@@ -168,13 +154,17 @@ static int wipe_exitMelt(int width, int height, int ticks)
 
 int wipe_StartScreen(int x, int y, int width, int height)
 {
-  I_ReadScreen(wipe_scr_start = screens[2]);
+  if (!wipe_scr_start)
+    wipe_scr_start = Z_Malloc(width*height, PU_STATIC, 0);
+  I_ReadScreen(wipe_scr_start);
   return 0;
 }
 
 int wipe_EndScreen(int x, int y, int width, int height)
 {
-  I_ReadScreen(wipe_scr_end = screens[3]);
+  if (!wipe_scr_end)
+    wipe_scr_end = Z_Malloc(width*height, PU_STATIC, 0);
+  I_ReadScreen(wipe_scr_end);
   V_DrawBlock(x, y, 0, width, height, wipe_scr_start); // restore start scr.
   return 0;
 }
@@ -188,10 +178,29 @@ static int (*const wipes[])(int, int, int) = {
   wipe_exitMelt
 };
 
+//
+// wipe_StopScreenWipe
+//
+// Ends a wipe, finished or not, and lets go of its screens.
+//
+
+void wipe_StopScreenWipe(int wipeno, int width, int height)
+{
+  if (go)
+    {
+      wipes[wipeno*3+2](width, height, 0);
+      go = 0;
+    }
+  if (wipe_scr_start)
+    Z_Free(wipe_scr_start);
+  if (wipe_scr_end)
+    Z_Free(wipe_scr_end);
+  wipe_scr_start = wipe_scr_end = NULL;
+}
+
 // killough 3/5/98: reformatted and cleaned up
 int wipe_ScreenWipe(int wipeno, int x, int y, int width, int height, int ticks)
 {
-  static boolean go;                               // when zero, stop the wipe
   if (!go)                                         // initial stuff
     {
       go = 1;
@@ -200,10 +209,7 @@ int wipe_ScreenWipe(int wipeno, int x, int y, int width, int height, int ticks)
     }
   V_MarkRect(0, 0, width, height);                 // do a piece of wipe-in
   if (wipes[wipeno*3+1](width, height, ticks))     // final stuff
-    {
-      wipes[wipeno*3+2](width, height, ticks);
-      go = 0;
-    }
+    wipe_StopScreenWipe(wipeno, width, height);
   return !go;
 }
 
@@ -45,6 +45,7 @@ int wipe_ScreenWipe (int wipeno,
                      int x, int y, int width, int height, int ticks);
 int wipe_StartScreen(int x, int y, int width, int height);
 int wipe_EndScreen  (int x, int y, int width, int height);
+void wipe_StopScreenWipe(int wipeno, int width, int height);
 
 #endif
 
@@ -31,6 +31,8 @@ rcsid[] = "$Id: g_game.c,v 1.63 1998/09/16 06:59:50 phares Exp $";
 
 #include <time.h>
 #include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "doomstat.h"
 #include "f_finale.h"
@@ -57,8 +59,13 @@ rcsid[] = "$Id: g_game.c,v 1.63 1998/09/16 06:59:50 phares Exp $";
 #include "r_sky.h"
 #include "d_deh.h"              // Ty 3/27/98 deh declarations
 #include "p_inter.h"
+#include "m_pack.h"
 #include "g_game.h"
 
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
 #define SAVEGAMESIZE  0x20000
 #define SAVESTRINGSIZE  24
 
@@ -67,7 +74,14 @@ static char     demoname[PATH_MAX];
 static boolean  netdemo;
 static byte     *demobuffer;   // made some static -- killough
 static size_t   maxdemosize;
+static int      demofd = -1;   // file a demo is being recorded to
+static int      demoflushtic;  // gametic of the next flush of a recording
+
+static void G_FlushDemo(void);
+static void G_WriteSaveBlock(void);
 static byte     *demo_p;
+static byte     *demoend;      // end of the demo data, for demos cut short
+static boolean  verifydemo;    // playing a demo file for -verifydemos
 static short    consistancy[MAXPLAYERS][BACKUPTICS];
 
 gameaction_t    gameaction;
@@ -171,6 +185,8 @@ int     key_weapon8;                                                //    |
 int     key_weapon9;                                                // phares
 
 int     key_screenshot;             // killough 2/22/98: screenshot key
+int     key_demorewind;             // wind a demo back or forward
+int     key_demoforward;
 int     mousebfire;
 int     mousebstrafe;
 int     mousebforward;
@@ -451,11 +467,11 @@ void G_BuildTiccmd(ticcmd_t* cmd)
         dclickstate2 = 0;
       }
 
-  forward += mousey;
+  forward += mousey/10;
   if (strafe)
-    side += mousex*2;
+    side += mousex/10*2;
   else
-    cmd->angleturn -= mousex*0x8;
+    cmd->angleturn -= mousex/10*0x8;
 
   mousex = mousey = 0;
 
@@ -485,6 +501,30 @@ void G_BuildTiccmd(ticcmd_t* cmd)
     }
 }
 
+//
+// G_PendingTurn
+//
+// The console player's turning not yet run in a tic, in angleturn units:
+// that in ticcmds built but still waiting, and that which the mouse has
+// made since the last ticcmd. With uncapped_framerate the view is drawn
+// turned by it, so that the mouse turns the view at once.
+//
+
+int G_PendingTurn(void)
+{
+  int turn = 0, tic;
+
+  if (!(gamekeydown[key_strafe] || mousebuttons[mousebstrafe] ||
+        joybuttons[joybstrafe]))
+    turn = -mousex/10*0x8;
+
+  if (ticdup == 1)
+    for (tic = gametic; tic < maketic; tic++)
+      turn += localcmds[tic%BACKUPTICS].angleturn;
+
+  return turn;
+}
+
 //
 // G_DoLoadLevel
 //
@@ -589,6 +629,151 @@ void G_DoLoadLevel (void)
 }
 
 
+//
+// Demo snapshots
+//
+// While a demo plays, the game is saved in memory every so often, the same
+// way as a savegame, so that the demo can be wound back or forward without
+// replaying it from the start: the last snapshot before the wanted tic is
+// loaded, and the tics from there on are run without drawing anything.
+// The snapshots are thinned out and spaced further apart whenever there
+// are too many, so long demos take no more memory than short ones.
+//
+
+int demo_snapshots;            // most snapshots kept (0 = none) -- config
+int demo_snapshot_secs;        // seconds of demo between them   -- config
+
+#define DEMOSEEKTICS (10*TICRATE)   // how far the seek keys go
+
+typedef struct {
+  int    tic;                  // demotic it was taken at
+  int    leveltic;             // gametic-levelstarttic, which the RNG uses
+  size_t demopos;              // offset of demo_p in the demo
+  byte   *data;                // see G_WriteGameState
+} demosnapshot_t;
+
+static demosnapshot_t *snapshots;
+static int numsnapshots;
+static int snapshotinterval;   // tics between snapshots
+static int demotic;            // demo tics played so far
+static int demoseek = -1;      // demo tic to seek to, or -1
+
+static void G_WriteGameState(void);
+static void G_ReadGameState(void);
+
+static void G_ClearDemoSnapshots(void)
+{
+  while (numsnapshots)
+    free(snapshots[--numsnapshots].data);
+  snapshots = realloc(snapshots, demo_snapshots * sizeof *snapshots);
+  snapshotinterval = demo_snapshot_secs * TICRATE;
+  demotic = 0;
+  demoseek = -1;
+}
+
+static void G_TakeDemoSnapshot(void)
+{
+  demosnapshot_t *snap;
+
+  if (numsnapshots >= demo_snapshots)      // full: drop every other one
+    {
+      int i;
+      for (i=0; i<numsnapshots; i++)
+        if (i & 1)
+          free(snapshots[i].data);
+        else
+          snapshots[i/2] = snapshots[i];
+      numsnapshots = (numsnapshots+1)/2;
+      snapshotinterval *= 2;
+      if (numsnapshots >= demo_snapshots ||
+          demotic < snapshots[numsnapshots-1].tic + snapshotinterval)
+        return;
+    }
+
+  save_p = savebuffer = malloc(savegamesize);
+  G_WriteGameState();
+
+  snap = &snapshots[numsnapshots++];
+  snap->tic = demotic;
+  snap->leveltic = gametic - levelstarttic;
+  snap->demopos = demo_p - demobuffer;
+  snap->data = realloc(savebuffer, save_p - savebuffer);
+  savebuffer = save_p = NULL;
+}
+
+static void G_LoadDemoSnapshot(const demosnapshot_t *snap)
+{
+  boolean compat = demo_compatibility, map = automapactive, view = viewactive;
+  int player = displayplayer;
+
+  save_p = savebuffer = snap->data;
+  precache = false;                        // as in G_DoPlayDemo
+  G_ReadGameState();
+  precache = true;
+  savebuffer = save_p = NULL;
+
+  // Put back what loading a savegame resets, but a demo keeps
+
+  demo_compatibility = compat;
+  usergame = false;
+  demoplayback = true;
+  levelstarttic = gametic - snap->leveltic;
+  demo_p = demobuffer + snap->demopos;
+  demotic = snap->tic;
+
+  if (automapactive != map)                // the viewer's, not the demo's
+    {
+      if (map)
+        AM_Start();
+      else
+        AM_Stop();
+    }
+  viewactive = view;
+
+  if ((displayplayer = player) != consoleplayer)
+    {
+      ST_Start();
+      HU_Start();
+    }
+}
+
+//
+// G_DemoSeek
+//
+// Loads the last snapshot at or before the wanted tic, if going back or
+// if it is ahead of the current tic, then runs the game up to the wanted
+// tic. Without a snapshot to go back to, a demo only goes forward.
+//
+
+static void G_DemoSeek(int tic)
+{
+  boolean nosfx = nosfxparm;
+  int i, tics = 0;
+
+  for (i = numsnapshots; i--; )
+    if (snapshots[i].tic <= tic)
+      {
+        if (tic < demotic || snapshots[i].tic > demotic)
+          G_LoadDemoSnapshot(&snapshots[i]);
+        break;
+      }
+
+  nosfxparm = true;                        // run the tics silently
+  while (demoplayback && demotic < tic)
+    {
+      G_Ticker();
+      gametic++;
+      tics++;
+    }
+  nosfxparm = nosfx;
+
+  gametic -= tics;                         // keep gametic in step with
+  levelstarttic -= tics;                   // the tics made, for netcode
+
+  wipegamestate = gamestate;               // no screen wipe
+}
+
+
 //
 // G_Responder
 // Get info needed to make ticcmd_ts for the players.
@@ -613,6 +798,17 @@ boolean G_Responder (event_t* ev)
       return true;
     }
 
+  // wind the demo back or forward, counting from any seek still pending
+
+  if (gamestate == GS_LEVEL && ev->type == ev_keydown && demoplayback &&
+      (ev->data1 == key_demorewind || ev->data1 == key_demoforward))
+    {
+      int tic = (demoseek >= 0 ? demoseek : demotic) +
+        (ev->data1 == key_demorewind ? -DEMOSEEKTICS : DEMOSEEKTICS);
+      demoseek = tic < 0 ? 0 : tic;
+      return true;
+    }
+
   // any other key pops up menu if in demos
   if (gameaction == ga_nothing && !singledemo &&
       (demoplayback || gamestate == GS_DEMOSCREEN))
@@ -664,8 +860,10 @@ boolean G_Responder (event_t* ev)
       mousebuttons[0] = ev->data1 & 1;
       mousebuttons[1] = ev->data1 & 2;
       mousebuttons[2] = ev->data1 & 4;
-      mousex = (ev->data2*(mouseSensitivity_horiz*4))/10;  // killough
-      mousey = (ev->data3*(mouseSensitivity_vert*4))/10;
+      // killough: sensitivity; the motion is gathered between ticcmds, in
+      // tenths, as with uncapped_framerate there are events every frame
+      mousex += ev->data2*(mouseSensitivity_horiz*4);
+      mousey += ev->data3*(mouseSensitivity_vert*4);
       return true;    // eat events
 
     case ev_joystick:
@@ -735,6 +933,22 @@ void G_Ticker (void)
         }
     }
 
+  if (demoplayback)
+    {
+      if (demoseek >= 0)              // seek once the gameaction is done
+        {
+          int tic = demoseek;
+          demoseek = -1;
+          G_DemoSeek(tic);
+        }
+
+      if (demoplayback && gamestate == GS_LEVEL && demo_snapshots &&
+          !verifydemo &&
+          (!numsnapshots ||
+           demotic >= snapshots[numsnapshots-1].tic + snapshotinterval))
+        G_TakeDemoSnapshot();
+    }
+
   // get commands, check consistancy, and build new consistancy check
   buf = (gametic/ticdup)%BACKUPTICS;
 
@@ -777,6 +991,16 @@ void G_Ticker (void)
         }
     }
 
+  if (demoplayback)
+    demotic++;
+
+  G_WriteSaveBlock();               // a savegame being written, if any
+
+  if (demorecording &&             // whole tics only, see G_FlushDemo
+      (demo_p - demobuffer > maxdemosize - 4*MAXPLAYERS ||
+       gametic - demoflushtic >= 0))
+    G_FlushDemo();
+
   // check for special buttons
   for (i=0; i<MAXPLAYERS; i++)
     {
@@ -1103,6 +1327,12 @@ void G_DoCompleted (void)
   if (automapactive)
     AM_Stop();
 
+  if (devparm)
+    {
+      extern void P_PrintPusherStats(void);   // p_spec.c
+      P_PrintPusherStats();
+    }
+
   if (gamemode != commercial) // kilough 2/7/98
     switch(gamemap)
       {
@@ -1294,22 +1524,79 @@ static void G_LoadGameErr(const char *msg)
 #define VERSIONSIZE   16
 
 // killough 2/22/98: version id string format for savegames
-#define VERSIONID "BoomVer %d"
+//
+// The second number is the savegame format, bumped whenever the layout
+// of what is saved changes without VERSION changing, so that saves from
+// an older build are caught instead of being loaded as garbage.
+
+#define VERSIONID "BoomVer %d.%d"
+#define SAVEVERSION 6
+
+//
+// G_ReadGameState
+//
+// Reads back what G_WriteGameState wrote: loads the level and puts it in
+// the saved state.
+//
+
+static void G_ReadGameState(void)
+{
+  int i, a, b, c;
+
+  // killough 2/14/98: load compatibility mode
+  compatibility = *save_p++;
+  demo_compatibility = false; // killough 3/1/98: force off, just to be safe
+
+  gameskill = *save_p++;
+  gameepisode = *save_p++;
+  gamemap = *save_p++;
+
+  save_p = G_ReadOptions(save_p);   // killough 3/1/98: Read game options
+
+  for (i=0 ; i<MAXPLAYERS ; i++)
+    playeringame[i] = *save_p++;
+  save_p += MIN_MAXPLAYERS-MAXPLAYERS;         // killough 2/28/98
+
+  idmusnum = *save_p++;           // jff 3/17/98 restore idmus music
+  if (idmusnum==255) idmusnum=-1; // jff 3/18/98 account for unsigned byte
+
+  // load a base level
+  G_InitNew (gameskill, gameepisode, gamemap);
+
+  // get the times
+  a = *save_p++;
+  b = *save_p++;
+  c = *save_p++;
+  leveltime = (a<<16) + (b<<8) + c;
+
+  // dearchive all the modifications
+  P_UnArchivePlayers ();
+  P_UnArchiveWorld ();
+  P_UnArchiveThinkers ();
+  P_UnArchiveSpecials ();
+  P_UnArchiveRNG ();    // killough 1/18/98: load RNG information
+  P_UnArchiveMap ();    // killough 1/22/98: load automap information
+
+  if (*save_p != 0xe6)
+    I_Error ("Bad savegame");
+}
 
 void G_DoLoadGame(void)
 {
-  int  length, i, a, b, c;
+  int  length;
   char vcheck[VERSIONSIZE];
 
   gameaction = ga_nothing;
 
+  G_FinishSaveGame();              // in case it is the one being loaded
+
   length = M_ReadFile(savename, &savebuffer);
   save_p = savebuffer + SAVESTRINGSIZE;
 
   // skip the description field
 
   // killough 2/22/98: "proprietary" version string :-)
-  sprintf (vcheck,VERSIONID,VERSION);
+  sprintf (vcheck,VERSIONID,VERSION,SAVEVERSION);
 
   // killough 2/22/98: Friendly savegame version difference message
   if (!forced_loadgame && strncmp(save_p, vcheck, VERSIONSIZE))
@@ -1344,45 +1631,45 @@ void G_DoLoadGame(void)
   save_p += sizeof(unsigned long);
   save_p += strlen(save_p)+1;
 
-  // killough 2/14/98: load compatibility mode
-  compatibility = *save_p++;
-  demo_compatibility = false; // killough 3/1/98: force off, just to be safe
-
-  gameskill = *save_p++;
-  gameepisode = *save_p++;
-  gamemap = *save_p++;
-
-  save_p = G_ReadOptions(save_p);   // killough 3/1/98: Read game options
-
-  for (i=0 ; i<MAXPLAYERS ; i++)
-    playeringame[i] = *save_p++;
-  save_p += MIN_MAXPLAYERS-MAXPLAYERS;         // killough 2/28/98
+  // unpack the rest, see G_WriteSaveBlock
 
-  idmusnum = *save_p++;           // jff 3/17/98 restore idmus music
-  if (idmusnum==255) idmusnum=-1; // jff 3/18/98 account for unsigned byte
+  {
+    byte *end = savebuffer + length, *body, *p;
+    long size, raw, packed;
 
-  // load a base level
-  G_InitNew (gameskill, gameepisode, gamemap);
+    if (end - save_p < sizeof size)
+      I_Error("Bad savegame");
+    memcpy(&size, save_p, sizeof size);
+    save_p += sizeof size;
+    if (size <= 0 || !(p = body = malloc(size)))
+      I_Error("Bad savegame");
 
-  // get the times
-  a = *save_p++;
-  b = *save_p++;
-  c = *save_p++;
-  leveltime = (a<<16) + (b<<8) + c;
+    for (; size > 0; p += raw, size -= raw, save_p += packed)
+      {
+        if (end - save_p < 2*sizeof(long))
+          I_Error("Bad savegame");
+        memcpy(&raw, save_p, sizeof raw);
+        memcpy(&packed, save_p + sizeof raw, sizeof packed);
+        save_p += 2*sizeof(long);
+        if (raw <= 0 || raw > size || packed <= 0 || packed > raw ||
+            end - save_p < packed)
+          I_Error("Bad savegame");
+        if (packed == raw)              // stored, as it would not pack
+          memcpy(p, save_p, raw);
+        else
+          if (M_Unpack(save_p, packed, p, raw) != raw)
+            I_Error("Bad savegame");
+      }
 
-  // dearchive all the modifications
-  P_UnArchivePlayers ();
-  P_UnArchiveWorld ();
-  P_UnArchiveThinkers ();
-  P_UnArchiveSpecials ();
-  P_UnArchiveRNG ();    // killough 1/18/98: load RNG information
-  P_UnArchiveMap ();    // killough 1/22/98: load automap information
+    Z_Free(savebuffer);
+    save_p = savebuffer = body;
+  }
 
-  if (*save_p != 0xe6)
-    I_Error ("Bad savegame");
+  G_ReadGameState();
 
   // done
-  Z_Free (savebuffer);
+  free(savebuffer);
+  savebuffer = save_p = NULL;
 
   if (setsizeneeded)
     R_ExecuteSetViewSize ();
@@ -1426,14 +1713,154 @@ void G_SaveGameName(char *name, int slot)
     sprintf (name, "%s/%s%d.dsg", basesavegame, savegamename, slot);
 }
 
+//
+// G_WriteGameState
+//
+// Writes everything in a savegame after its header, which is the game
+// settings and the state of the level. Also used for demo snapshots.
+//
+
+static void G_WriteGameState(void)
+{
+  int i;
+
+  CheckSaveGame(GAME_OPTION_SIZE+MIN_MAXPLAYERS+10);
+
+  // killough 2/14/98: save compatibility flag:
+  *save_p++ = compatibility;
+
+  *save_p++ = gameskill;
+  *save_p++ = gameepisode;
+  *save_p++ = gamemap;
+
+  save_p = G_WriteOptions(save_p);    // killough 3/1/98: save game options
+
+  for (i=0 ; i<MAXPLAYERS ; i++)
+    *save_p++ = playeringame[i];
+
+  for (;i<MIN_MAXPLAYERS;i++)         // killough 2/28/98
+    *save_p++ = 0;
+
+  *save_p++ = idmusnum;               // jff 3/17/98 save idmus state
+
+  *save_p++ = leveltime>>16;
+  *save_p++ = leveltime>>8;
+  *save_p++ = leveltime;
+
+  // killough 3/22/98: add Z_CheckHeap after each call to ensure consistency
+  Z_CheckHeap();
+  P_ArchivePlayers();
+  Z_CheckHeap();
+  P_ArchiveWorld();
+  Z_CheckHeap();
+  P_ArchiveThinkers();
+  Z_CheckHeap();
+  P_ArchiveSpecials();
+  P_ArchiveRNG();    // killough 1/18/98: save RNG information
+  Z_CheckHeap();
+  P_ArchiveMap();    // killough 1/22/98: save automap information
+
+  *save_p++ = 0xe6;   // consistancy marker
+}
+
+//
+// Savegames are written in two parts. G_DoSaveGame takes the snapshot and
+// writes the header, which is left unpacked for M_ReadSaveStrings, and
+// G_WriteSaveBlock then packs and writes the rest a block a tic, so that
+// saving a big level does not stall the game. The file is written under
+// a temporary name and renamed once it is complete, so that an earlier
+// save in the slot survives a crash part way through.
+//
+// After the header comes the unpacked size of the rest, as a long, and
+// then the blocks, each a long with its unpacked size and a long with its
+// packed size, followed by the packed data. A block which would not pack
+// is written as it is, with the two sizes equal.
+//
+
+#define SAVEBLOCKSIZE 0x10000
+
+static byte *savepending;       // snapshot being written, or NULL
+static byte *savepending_p, *savepending_end;
+static int  savefd = -1;
+static char savetempname[PATH_MAX+1];
+static char savefilename[PATH_MAX+1];
+
+static void G_AbortSaveGame(void)
+{
+  if (savefd != -1)
+    close(savefd);
+  savefd = -1;
+  remove(savetempname);
+  free(savepending);
+  savepending = NULL;
+  players[consoleplayer].message = "Could not write savegame";
+}
+
+static void G_WriteSaveBlock(void)
+{
+  static byte *packbuffer;
+  long sizes[2];
+  byte *data;
+
+  if (!savepending)
+    return;
+
+  if (savepending_p == savepending_end)
+    {
+      fsync(savefd);
+      close(savefd);
+      savefd = -1;
+      remove(savefilename);
+      if (rename(savetempname, savefilename))
+        G_AbortSaveGame();
+      else
+        {
+          free(savepending);
+          savepending = NULL;
+          players[consoleplayer].message = s_GGSAVED;  // Ty 03/27/98
+        }
+      return;
+    }
+
+  if (!packbuffer)
+    packbuffer = malloc(SAVEBLOCKSIZE);
+
+  sizes[0] = savepending_end - savepending_p;
+  if (sizes[0] > SAVEBLOCKSIZE)
+    sizes[0] = SAVEBLOCKSIZE;
+
+  if ((sizes[1] = M_Pack(savepending_p, sizes[0], packbuffer, sizes[0]-1)))
+    data = packbuffer;
+  else
+    sizes[1] = sizes[0], data = savepending_p;
+
+  if (write(savefd, sizes, sizeof sizes) != sizeof sizes ||
+      write(savefd, data, sizes[1]) != sizes[1])
+    G_AbortSaveGame();
+  else
+    savepending_p += sizes[0];
+}
+
+// Writes the rest of a savegame being written, if any, at once.
+
+void G_FinishSaveGame(void)
+{
+  while (savepending)
+    G_WriteSaveBlock();
+}
+
 void G_DoSaveGame (void)
 {
-  char name[PATH_MAX+1];
   char name2[VERSIONSIZE];
   char *description;
-  int  length, i;
+  long length;
+
+  G_FinishSaveGame();               // one at a time
+
+  G_SaveGameName(savefilename,savegameslot);
 
-  G_SaveGameName(name,savegameslot);
+  // the extension is always there, see G_SaveGameName
+  strcpy(strrchr(strcpy(savetempname, savefilename), '.'), ".tmp");
 
   description = savedescription;
 
@@ -1445,7 +1872,7 @@ void G_DoSaveGame (void)
   memset (name2,0,sizeof(name2));
 
   // killough 2/22/98: "proprietary" version string :-)
-  sprintf (name2,VERSIONID,VERSION);
+  sprintf (name2,VERSIONID,VERSION,SAVEVERSION);
 
   memcpy (save_p, name2, VERSIONSIZE);
   save_p += VERSIONSIZE;
@@ -1471,70 +1898,32 @@ void G_DoSaveGame (void)
     save_p += strlen(save_p)+1;
   }
 
-  CheckSaveGame(GAME_OPTION_SIZE+MIN_MAXPLAYERS+10);
-
-  // killough 2/14/98: save compatibility flag:
-  *save_p++ = compatibility;
-
-  *save_p++ = gameskill;
-  *save_p++ = gameepisode;
-  *save_p++ = gamemap;
-
-  save_p = G_WriteOptions(save_p);    // killough 3/1/98: save game options
-
-  for (i=0 ; i<MAXPLAYERS ; i++)
-    *save_p++ = playeringame[i];
-
-  for (;i<MIN_MAXPLAYERS;i++)         // killough 2/28/98
-    *save_p++ = 0;
-
-  *save_p++ = idmusnum;               // jff 3/17/98 save idmus state
-
-  *save_p++ = leveltime>>16;
-  *save_p++ = leveltime>>8;
-  *save_p++ = leveltime;
-
-  // killough 3/22/98: add Z_CheckHeap after each call to ensure consistency
-  Z_CheckHeap();
-  P_ArchivePlayers();
-  Z_CheckHeap();
-
-  // phares 9/13/98: Move mobj_t->index out of P_ArchiveThinkers so the
-  // indices can be used by P_ArchiveWorld when the sectors are saved.
-  // This is so we can save the index of the mobj_t of the thinker that
-  // caused a sound, referenced by sector_t->soundtarget.
-
-  P_ThinkerToIndex();
-
-  P_ArchiveWorld();
-  Z_CheckHeap();
-  P_ArchiveThinkers();
-
-  // phares 9/13/98: Move index->mobj_t out of P_ArchiveThinkers, simply
-  // for symmetry with the P_ThinkerToIndex call above.
+  length = save_p - savebuffer;
 
-  P_IndexToThinker();
+  G_WriteGameState();
 
   Z_CheckHeap();
-  P_ArchiveSpecials();
-  P_ArchiveRNG();    // killough 1/18/98: save RNG information
-  Z_CheckHeap();
-  P_ArchiveMap();    // killough 1/22/98: save automap information
-
-  *save_p++ = 0xe6;   // consistancy marker
-
-  length = save_p - savebuffer;
 
-  Z_CheckHeap();
-  M_WriteFile(name, savebuffer, length);
+  // write the header now, and leave the rest to G_WriteSaveBlock
 
-  free(savebuffer);  // killough
+  savepending = savebuffer;
+  savepending_p = savebuffer + length;
+  savepending_end = save_p;
   savebuffer = save_p = NULL;
 
   gameaction = ga_nothing;
   savedescription[0] = 0;
 
-  players[consoleplayer].message = s_GGSAVED;  // Ty 03/27/98 - externalized
+  savefd = open(savetempname, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+
+  if (savefd == -1 || write(savefd, savepending, length) != length)
+    G_AbortSaveGame();
+  else
+    {
+      length = savepending_end - savepending_p;
+      if (write(savefd, &length, sizeof length) != sizeof length)
+        G_AbortSaveGame();
+    }
 }
 
 static skill_t d_skill;
@@ -1598,6 +1987,7 @@ void G_ReloadDefaults(void)
 
   demoplayback = false;
   netdemo = false;
+  G_ClearDemoSnapshots();
 
   // killough 2/21/98:
   memset(playeringame+1, 0, sizeof(*playeringame)*(MAXPLAYERS-1));
@@ -1735,7 +2125,7 @@ void G_InitNew(skill_t skill, int episode, int map)
 
 void G_ReadDemoTiccmd (ticcmd_t* cmd)
 {
-  if (*demo_p == DEMOMARKER)
+  if ((demoplayback && demo_p >= demoend) || *demo_p == DEMOMARKER)
     G_CheckDemoStatus();      // end of demo data stream
   else
     {
@@ -1750,8 +2140,6 @@ void G_ReadDemoTiccmd (ticcmd_t* cmd)
 
 void G_WriteDemoTiccmd (ticcmd_t* cmd)
 {
-  ptrdiff_t position = demo_p - demobuffer;
-
   // 2/8/98 killough: stop 'q' from quitting demo recording
   //
   // if (gamekeydown['q'])           // press q to end demo recording
@@ -1762,16 +2150,37 @@ void G_WriteDemoTiccmd (ticcmd_t* cmd)
   demo_p[2] = (cmd->angleturn+128)>>8;
   demo_p[3] = cmd->buttons;
 
-  if (position > maxdemosize - 16)
+  G_ReadDemoTiccmd (cmd);         // make SURE it is exactly the same
+}
+
+//
+// G_FlushDemo
+//
+// A recording is written to its file as it goes, rather than all at the
+// end, so that neither a long recording nor a crash can lose it. The
+// buffer is written out whenever it is nearly full, and every few seconds
+// anyway, at the end of a tic. The end marker is written after it each
+// time, and written over by the next flush, so that the file is always a
+// complete demo up to the last flush.
+//
+
+#define DEMOFLUSHTICS (5*TICRATE)
+
+static void G_FlushDemo(void)
+{
+  static const byte marker = DEMOMARKER;
+  int length = demo_p - demobuffer;
+
+  if (write(demofd, demobuffer, length) != length ||
+      write(demofd, &marker, 1) != 1 || lseek(demofd, -1, SEEK_CUR) == -1)
     {
-      // no more space
-      maxdemosize += 128*1024;   // add another 128K  -- killough
-      demobuffer = realloc(demobuffer,maxdemosize);
-      demo_p = position + demobuffer;  // back on track
-      // end of main demo limit changes -- killough
+      demorecording = false;      // so that I_Quit does not try again
+      I_Error("Error writing demo %s", demoname);
     }
 
-  G_ReadDemoTiccmd (cmd);         // make SURE it is exactly the same
+  fsync(demofd);                  // make it survive a crash
+  demo_p = demobuffer;
+  demoflushtic = gametic + DEMOFLUSHTICS;
 }
 
 //
@@ -1783,12 +2192,15 @@ void G_RecordDemo (char* name)
   int i;
   usergame = false;
   AddDefaultExtension(strcpy(demoname, name), ".lmp");  // 1/18/98 killough
-  i = M_CheckParm ("-maxdemo");
+  i = M_CheckParm ("-maxdemo");   // now just the size of the write buffer
   if (i && i<myargc-1)
     maxdemosize = atoi(myargv[i+1])*1024;
   if (maxdemosize < 0x20000)  // killough
     maxdemosize = 0x20000;
   demobuffer = malloc(maxdemosize); // killough
+  demofd = open(demoname, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+  if (demofd == -1)
+    I_Error("Couldn't create demo %s", demoname);
   demorecording = true;
 }
 
@@ -1921,6 +2333,8 @@ void G_BeginRecording (void)
 
   for (; i<MIN_MAXPLAYERS; i++)
     *demo_p++ = 0;
+
+  G_FlushDemo();                   // an empty demo, to begin with
 }
 
 //
@@ -1944,7 +2358,19 @@ void G_DoPlayDemo (void)
 
   ExtractFileBase(defdemoname,basename);           // killough
   gameaction = ga_nothing;
-  demobuffer = demo_p = W_CacheLumpName (basename, PU_STATIC);  // killough
+
+  if (verifydemo)                  // -verifydemos reads files, not lumps
+    {
+      int length = M_ReadFile(defdemoname, &demobuffer);
+      demoend = demobuffer + length;
+    }
+  else
+    {
+      int lump = W_GetNumForName(basename);
+      demobuffer = W_CacheLumpNum(lump, PU_STATIC);  // killough
+      demoend = demobuffer + W_LumpLength(lump);
+    }
+  demo_p = demobuffer;
 
   // killough 2/22/98, 2/28/98: autodetect old demos and act accordingly.
   // Old demos turn on demo_compatibility => compatibility; new demos load
@@ -2038,6 +2464,17 @@ void G_DoPlayDemo (void)
 
   for (i=0; i<MAXPLAYERS;i++)         // killough 4/24/98
     players[i].cheats = 0;
+
+  G_ClearDemoSnapshots();
+
+  // -skipsec: start the first demo played this many seconds in
+
+  {
+    static boolean skipped;
+    if (!skipped && (i = M_CheckParm("-skipsec")) && i < myargc-1)
+      demoseek = atof(myargv[i+1]) * TICRATE;
+    skipped = true;
+  }
 }
 
 //
@@ -2052,6 +2489,135 @@ void G_TimeDemo(char *name)
   gameaction = ga_playdemo;
 }
 
+//
+// Demo verification
+//
+// For -verifydemos, demo files are played through G_Ticker alone, and the
+// way each one ended is written in a line of a report, to be compared
+// between builds: whether the level was left or the player died or
+// neither (which is usually a desync), the tic it ended on, the totals
+// for the last level and a hash of the game state at the end.
+//
+
+const char *const demoverdicts[NUMDEMOVERDICTS] = {
+  "exit", "death", "ingame", "missing", "failed"
+};
+
+static demoverdict_t verdict;
+static char *verifyline;
+
+// FNV-1a over whole words, kept to 32 bits for the same hash everywhere
+#define HASH(h,x) ((h) = (((h) ^ (unsigned long)(x)) * 16777619ul) & 0xffffffff)
+
+static unsigned long G_StateHash(void)
+{
+  unsigned long hash = 2166136261ul;
+  thinker_t *th;
+  int i;
+
+  for (th = mobjthinkercap.mnext;
+       th != &mobjthinkercap; th = th->mnext)
+    {
+      const mobj_t *mo = (mobj_t *) th;
+      HASH(hash, mo->x);
+      HASH(hash, mo->y);
+      HASH(hash, mo->z);
+      HASH(hash, mo->momx);
+      HASH(hash, mo->momy);
+      HASH(hash, mo->momz);
+      HASH(hash, mo->angle);
+      HASH(hash, mo->type);
+      HASH(hash, mo->health);
+      HASH(hash, mo->flags);
+      HASH(hash, mo->state - states);
+      HASH(hash, mo->tics);
+    }
+
+  for (i=0; i<numsectors; i++)
+    {
+      HASH(hash, sectors[i].floorheight);
+      HASH(hash, sectors[i].ceilingheight);
+    }
+
+  for (i=0; i<MAXPLAYERS; i++)
+    if (playeringame[i])
+      {
+        HASH(hash, players[i].health);
+        HASH(hash, players[i].armorpoints);
+        HASH(hash, players[i].readyweapon);
+      }
+
+  for (i=0; i<NUMPRCLASS; i++)
+    HASH(hash, rng.seed[i]);
+  HASH(hash, rng.rndindex);
+  HASH(hash, rng.prndindex);
+  HASH(hash, leveltime);
+
+  return hash;
+}
+
+static void G_EndVerifyDemo(void)
+{
+  int i, kills = 0, items = 0, secrets = 0;
+  char map[8];
+
+  for (i=0; i<MAXPLAYERS; i++)
+    if (playeringame[i])
+      {
+        kills += players[i].killcount;
+        items += players[i].itemcount;
+        secrets += players[i].secretcount;
+      }
+
+  verdict =
+    gamestate != GS_LEVEL || gameaction == ga_completed ||
+    gameaction == ga_victory ? dv_exit :
+    players[consoleplayer].playerstate != PST_LIVE ? dv_death : dv_ingame;
+
+  if (gamemode == commercial)
+    sprintf(map, "MAP%02d", gamemap);
+  else
+    sprintf(map, "E%dM%d", gameepisode, gamemap);
+
+  sprintf(verifyline, "%s %s %s tic=%d kills=%d/%d items=%d/%d "
+          "secrets=%d/%d hash=%08lx", defdemoname, demoverdicts[verdict],
+          map, demotic, kills, totalkills, items, totalitems,
+          secrets, totalsecret, G_StateHash());
+}
+
+//
+// G_VerifyDemo
+//
+// Plays a demo file to its end, for -verifydemos, and writes the report
+// line for it.
+//
+
+demoverdict_t G_VerifyDemo(char *name, char *line)
+{
+  FILE *f = fopen(name, "rb");
+
+  if (!f)
+    {
+      sprintf(line, "%s %s", name, demoverdicts[dv_missing]);
+      return dv_missing;
+    }
+  fclose(f);
+
+  verifydemo = true;
+  verifyline = line;
+  defdemoname = name;
+  G_DoPlayDemo();
+
+  while (demoplayback)
+    {
+      G_Ticker();
+      gametic++;
+    }
+
+  verifydemo = false;
+  return verdict;
+}
+
 //===================
 //=
 //= G_CheckDemoStatus
@@ -2064,9 +2630,10 @@ boolean G_CheckDemoStatus (void)
 {
   if (demorecording)
     {
+      G_FlushDemo();         // writes the end marker after the rest
       demorecording = false;
-      *demo_p++ = DEMOMARKER;
-      M_WriteFile (demoname, demobuffer, demo_p - demobuffer);
+      close(demofd);
+      demofd = -1;
       free(demobuffer);
       demobuffer = NULL;  // killough
       I_Error("Demo %s recorded",demoname);
@@ -2085,6 +2652,17 @@ boolean G_CheckDemoStatus (void)
 
   if (demoplayback)
     {
+      if (verifydemo)        // just note how it ended, and stop
+        {
+          G_EndVerifyDemo();
+          Z_Free(demobuffer);
+          demobuffer = NULL;
+          G_ReloadDefaults();
+          netgame = false;
+          deathmatch = false;
+          return true;
+        }
+
       if (singledemo)
         exit(0);  // killough
 
@@ -58,6 +58,7 @@ void G_SecretExitLevel(void);
 void G_WorldDone(void);
 void G_Ticker(void);
 void G_ScreenShot(void);
+int  G_PendingTurn(void);      // turning not yet run, for drawing the view
 void G_ReloadDefaults(void);     // killough 3/1/98: loads game defaults
 void G_SaveGameName(char *,int); // killough 3/22/98: sets savegame filename
 void G_SetFastParms(int);        // killough 4/10/98: sets -fast parameters
@@ -66,6 +67,7 @@ void G_DoReborn(int playernum);
 void G_DoPlayDemo(void);
 void G_DoCompleted(void);
 void G_DoSaveGame(void);
+void G_FinishSaveGame(void);   // writes out a savegame still being written
 void G_ReadDemoTiccmd(ticcmd_t *cmd);
 void G_WriteDemoTiccmd(ticcmd_t *cmd);
 void G_DoWorldDone(void);
@@ -77,6 +79,20 @@ void G_DoLoadLevel(void  );
 void G_DoLoadGame(void);
 void G_DoVictory(void);
 
+// How a demo played by G_VerifyDemo ended, for -verifydemos
+typedef enum {
+  dv_exit,         // left the level
+  dv_death,        // the player was dead
+  dv_ingame,       // neither, which usually means it went out of sync
+  dv_missing,      // no such file
+  dv_failed,       // the process playing it stopped with an error
+  NUMDEMOVERDICTS
+} demoverdict_t;
+
+extern const char *const demoverdicts[NUMDEMOVERDICTS];
+
+demoverdict_t G_VerifyDemo(char *name, char *line);
+
 // killough 1/18/98: Doom-style printf;   killough 4/25/98: add gcc attributes
 void dprintf(const char *, ...) __attribute__((format(printf,1,2)));
 
@@ -149,6 +165,8 @@ extern int  key_map_mark;                                           //    ^
 extern int  key_map_clear;                                          //    |
 extern int  key_map_grid;                                           // phares
 extern int  key_screenshot;    // killough 2/22/98 -- add key for screenshot
+extern int  key_demorewind;    // wind a demo back or forward
+extern int  key_demoforward;
 extern int  autorun;           // always running?                   // phares
 
 extern int  defaultskill;      //jff 3/24/98 default skill
@@ -156,6 +174,9 @@ extern boolean haswolflevels;  //jff 4/18/98 wolf levels present
 
 extern int  bodyquesize;       // killough 2/8/98: adustable corpse limit
 
+extern int  demo_snapshots;     // most demo snapshots kept in memory
+extern int  demo_snapshot_secs; // seconds of demo between snapshots
+
 // killough 5/2/98: moved from d_deh.c:
 // Par times (new item with BOOM) - from g_game.c
 extern int pars[4][10];  // hardcoded array size
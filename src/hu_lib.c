@@ -97,6 +97,8 @@ void HUlib_initTextLine
   t->f = f;
   t->sc = sc;
   t->cr = cr;
+  if (t->drawn)
+    Z_Free(t->drawn);
   HUlib_clearTextLine(t);
 }
 
@@ -153,9 +155,22 @@ boolean HUlib_delCharFromTextLine(hu_textline_t* t)
 //
 // Draws a hu_textline_t widget
 //
+// Most lines are drawn every frame just as they were the frame before,
+// even when their text is built again each time, as the HUD's is. So the
+// glyphs are put together into an overlay, which is drawn in one pass,
+// and made again only when the text, color, place or cursor change.
+//
 // Passed the hu_textline_t and flag whether to draw a cursor
 // Returns nothing
 //
+
+typedef struct {          // what a line's overlay was made from
+  int x, y, sc, cursor, len;
+  char *cr;
+  patch_t **f;
+  char l[1];              // the text, len+1 bytes of it
+} hu_drawnline_t;
+
 void HUlib_drawTextLine
 ( hu_textline_t* l,
   boolean drawcursor )
@@ -167,6 +182,24 @@ void HUlib_drawTextLine
   unsigned char c;
   char *oc = l->cr;       //jff 2/17/98 remember default color
   int y = l->y;           // killough 1/18/98 -- support multiple lines
+  hu_drawnline_t *drawn;
+
+  if (l->drawn)
+    {
+      drawn = V_OverlayData(l->drawn);
+      if (drawn->x == l->x && drawn->y == l->y && drawn->sc == l->sc &&
+          drawn->cursor == drawcursor && drawn->cr == l->cr &&
+          drawn->f == l->f && drawn->len == l->len &&
+          !memcmp(drawn->l, l->l, l->len))
+        {
+          Z_ChangeTag(l->drawn, PU_CACHE);    // mark recently used
+          V_DrawOverlay(l->drawn, FG);
+          return;
+        }
+      Z_Free(l->drawn);
+    }
+
+  V_BeginOverlay();
 
   // draw the new stuff
   x = l->x;
@@ -190,7 +223,7 @@ void HUlib_drawTextLine
       if (x+w > SCREENWIDTH)
         break;
       // killough 1/18/98 -- support multiple lines:
-      V_DrawPatchTranslated(x, y, FG, l->f[c - l->sc], l->cr, 0);
+      V_OverlayPatch(x, y, l->f[c - l->sc], l->cr == cr_red ? NULL : l->cr);
       x += w;
     }
     else
@@ -206,8 +239,22 @@ void HUlib_drawTextLine
   if (drawcursor && x + SHORT(l->f['_' - l->sc]->width) <= SCREENWIDTH)
   {
     // killough 1/18/98 -- support multiple lines
-    V_DrawPatchDirect(x, y, FG, l->f['_' - l->sc]);
+    V_OverlayPatch(x, y, l->f['_' - l->sc], NULL);
   }
+
+  V_EndOverlay(sizeof(hu_drawnline_t) + l->len,
+               (void **) &l->drawn);
+  drawn = V_OverlayData(l->drawn);
+  drawn->x = l->x;
+  drawn->y = l->y;
+  drawn->sc = l->sc;
+  drawn->cursor = drawcursor;
+  drawn->cr = l->cr;
+  drawn->f = l->f;
+  drawn->len = l->len;
+  memcpy(drawn->l, l->l, l->len);
+  drawn->l[l->len] = 0;
+  V_DrawOverlay(l->drawn, FG);
 }
 
 //
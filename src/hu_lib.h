@@ -74,6 +74,9 @@ typedef struct
   // whether this line needs to be udpated
   int   needsupdate;        
 
+  // the line as last drawn, as an overlay, see HUlib_drawTextLine
+  byte  *drawn;                         // PU_CACHE, NULL if purged
+
 } hu_textline_t;
 
 
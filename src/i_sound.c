@@ -40,6 +40,7 @@ rcsid[] = "$Id: i_sound.c,v 1.16 1998/09/07 20:06:36 jim Exp $";
 #include "g_game.h"     //jff 1/21/98 added to use dprintf in I_RegisterSong
 #include "d_main.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
+#include "m_vidcap.h"
 
 // Needed for calling the actual sound output.
 #define SAMPLECOUNT             512
@@ -213,6 +214,11 @@ int I_StartSound(int sfx, int   vol, int sep, int pitch, int pri)
   // Start the sound
   play_sample(&channel[handle], vol*VOLSCALE+VOLSCALE-1, 256-sep, PITCH(pitch), 0);
 
+  if (vidcapture)    // -viddump mixes its own copy
+    M_VidCapStartSound(handle, channel[handle].data, channel[handle].len,
+                       channel[handle].freq, vol*VOLSCALE+VOLSCALE-1,
+                       256-sep, PITCH(pitch));
+
   // Reference for s_sound.c to use when calling functions below
   return handle;
 }
@@ -223,6 +229,8 @@ int I_StartSound(int sfx, int   vol, int sep, int pitch, int pri)
 void I_StopSound (int handle)
 {
   stop_sample(channel+handle);
+  if (vidcapture)
+    M_VidCapStopSound(handle);
 }
 
 // Update the sound parameters. Used to control volume,
@@ -237,6 +245,8 @@ void I_UpdateSoundParams(int handle, int vol, int sep, int pitch)
                 PITCH(pitch),
                 0
                );
+  if (vidcapture)
+    M_VidCapSoundParams(handle, vol*VOLSCALE+VOLSCALE-1, 256-sep, PITCH(pitch));
 }
 
 // We can pretend that any sound that we've associated a handle
@@ -74,10 +74,13 @@ void I_EndRead(void)
 //
 
 static volatile int realtic;
+static volatile int realms;       // see I_GetTimeMS below
+static volatile int realticms;    // realms when realtic last went up
 
 void I_timer(void)
 {
   realtic++;
+  realticms = realms;
 }
 END_OF_FUNCTION(I_timer);
 
@@ -94,6 +97,30 @@ int I_GetTime_Scaled(void)
   return (long long) realtic * I_GetTime_Scale >> 24;
 }
 
+// A millisecond clock, for timing parts of a frame and for how far into
+// a tic a frame is drawn. It is only run for auto_viewsize and
+// uncapped_framerate, as a 1000 Hz interrupt is not free on slower
+// machines.
+
+static void I_mstimer(void)
+{
+  realms++;
+}
+static END_OF_FUNCTION(I_mstimer);
+
+int I_GetTimeMS(void)
+{
+  return realms;
+}
+
+// How far the tic clock is into its current tic, out of FRACUNIT
+
+int I_GetFracTime(void)
+{
+  int ms = realms - realticms;
+  return ms >= 1000/TICRATE ? FRACUNIT : (ms << FRACBITS) * TICRATE / 1000;
+}
+
 static int  I_GetTime_FastDemo(void)
 {
   static int fasttic;
@@ -141,7 +168,7 @@ void I_Shutdown(void)
 
 void I_Init(void)
 {
-  extern int key_autorun;
+  extern int key_autorun, auto_viewsize, uncapped_framerate;
 
   //init timer
   LOCK_VARIABLE(realtic);
@@ -149,6 +176,14 @@ void I_Init(void)
   install_timer();
   install_int_ex(I_timer,BPS_TO_TIMER(TICRATE));
 
+  if (auto_viewsize || uncapped_framerate)
+    {
+      LOCK_VARIABLE(realms);
+      LOCK_VARIABLE(realticms);
+      LOCK_FUNCTION(I_mstimer);
+      install_int_ex(I_mstimer,MSEC_TO_TIMER(1));
+    }
+
   // killough 4/14/98: Adjustable speedup based on realtic_clock_rate
   if (fastdemo)
     I_GetTime = I_GetTime_FastDemo;
@@ -229,10 +264,15 @@ void I_Quit (void)
 {
   has_exited=1;   /* Prevent infinitely recursive exits -- killough */
 
+  G_FinishSaveGame();
+
   if (demorecording)
     G_CheckDemoStatus();
   M_SaveDefaults ();
 
+  if (devparm)
+    Z_PrintCacheStats();
+
   if (*errmsg)
     //jff 8/3/98 use logical output routine
     lprintf (LO_ERROR, "%s\n", errmsg);
@@ -46,6 +46,8 @@ void I_Init(void);
 int (*I_GetTime)();           // killough
 int I_GetTime_RealTime();     // killough
 int I_GetTime_Adaptive(void); // killough 4/10/98
+int I_GetTimeMS(void);         // milliseconds, if auto_viewsize is on
+int I_GetFracTime(void);       // how far into a tic, if uncapped_framerate
 extern int GetTime_Scale;
 
 //
@@ -41,6 +41,8 @@ rcsid[] = "$Id: i_video.c,v 1.12 1998/05/03 22:40:35 killough Exp $";
 #include "doomstat.h"
 #include "v_video.h"
 #include "d_main.h"
+#include "m_vidcap.h"
+#include "lprintf.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -210,6 +212,108 @@ int use_vsync = 1;   // killough 2/8/98: controls whether vsync is called
 
 static byte *dascreen;
 
+//
+// Truecolor presentation
+//
+// With use_truecolor, frames are shown through a 32-bit video mode. The
+// game still draws 8-bit frames, which are expanded through the palette
+// into a memory bitmap and blitted to the screen.
+//
+// Only the rows which differ from the frame last shown are expanded and
+// blitted, in runs, unless the palette has changed. The boxes kept by
+// V_MarkRect are not enough for this, since the view, automap, border
+// and finale backgrounds are drawn straight into screens[0].
+//
+// Palettes are expanded once, and kept by contents and gamma, as the
+// status bar's damage and bonus flashes go through a few over and over.
+//
+
+int use_truecolor;                // 1 to use a 32-bit video mode
+
+static BITMAP *truescreen;        // NULL if not in truecolor
+static byte *lastscreen;          // the 8-bit frame last shown
+static boolean truerefresh;       // show every row: the palette changed
+
+#define TRUEPALETTES 16
+
+typedef struct {
+  byte raw[768];
+  int gamma;
+  unsigned long pixels[256];
+} truepalette_t;
+
+static truepalette_t truepalettes[TRUEPALETTES];
+static int numtruepalettes, nexttruepalette;
+static const unsigned long *truepalette = truepalettes[0].pixels;
+
+static void I_SetTruePalette(const byte *palette)
+{
+  truepalette_t *p = truepalettes;
+  int i;
+
+  for (i = 0; i < numtruepalettes; i++, p++)
+    if (p->gamma == usegamma && !memcmp(p->raw, palette, sizeof p->raw))
+      break;
+
+  if (i == numtruepalettes)
+    {
+      if (numtruepalettes < TRUEPALETTES)
+        p = &truepalettes[numtruepalettes++];
+      else
+        {
+          p = &truepalettes[nexttruepalette];
+          nexttruepalette = (nexttruepalette+1) % TRUEPALETTES;
+        }
+      memcpy(p->raw, palette, sizeof p->raw);
+      p->gamma = usegamma;
+      for (i = 0; i < 256; i++, palette += 3)
+        p->pixels[i] = makecol32(gammatable[usegamma][palette[0]],
+                                 gammatable[usegamma][palette[1]],
+                                 gammatable[usegamma][palette[2]]);
+      truerefresh = true;         // the slot may be the one in use
+    }
+
+  if (truepalette != p->pixels)
+    {
+      truepalette = p->pixels;
+      truerefresh = true;
+    }
+}
+
+static void I_FinishTrueUpdate(void)
+{
+  const byte *src = screens[0];
+  byte *last = lastscreen;
+  int y, top = -1;
+
+  for (y = 0; y <= SCREENHEIGHT; y++, src += SCREENWIDTH, last += SCREENWIDTH)
+    if (y < SCREENHEIGHT && (truerefresh || memcmp(src, last, SCREENWIDTH)))
+      {
+        unsigned long *dest = (unsigned long *) truescreen->line[y];
+        const unsigned long *pal = truepalette;
+        int x;
+
+        for (x = 0; x < SCREENWIDTH; x += 4)   // SCREENWIDTH%4 == 0
+          {
+            dest[x  ] = pal[src[x  ]];
+            dest[x+1] = pal[src[x+1]];
+            dest[x+2] = pal[src[x+2]];
+            dest[x+3] = pal[src[x+3]];
+          }
+        memcpy(last, src, SCREENWIDTH);
+        if (top < 0)
+          top = y;
+      }
+    else
+      if (top >= 0)                             // end of a run of rows
+        {
+          blit(truescreen, screen, 0, top, 0, top, SCREENWIDTH, y - top);
+          top = -1;
+        }
+
+  truerefresh = false;
+}
+
 void I_FinishUpdate(void)
 {
   static int     lasttic;
@@ -217,6 +321,8 @@ void I_FinishUpdate(void)
   int            i;
   extern boolean noblit;        // killough 1/31/98
 
+  M_VidCapFrame();              // -viddump writes out each frame
+
   if (noblit)
     return;
 
@@ -240,9 +346,15 @@ void I_FinishUpdate(void)
   // selected, or the user does not want to use vsync,
   // use vsync() to prevent screen breaks.
 
-  if (!timingdemo && use_vsync)
+  if (!timingdemo && !vidcapture && use_vsync)
     vsync();
 
+  if (truescreen)
+    {
+      I_FinishTrueUpdate();
+      return;
+    }
+
   // 1/16/98 killough: optimization based on CPU type
 
   if (cpu_family == 6)     // PPro, PII
@@ -274,6 +386,19 @@ void I_ReadScreen (byte* scr)
 void I_SetPalette (byte *palette)
 {
   int i;
+
+  if (vidcapture)
+    M_VidCapPalette(palette);
+
+  if (nodrawers)           // still in text mode, whose colors would change
+    return;
+
+  if (truescreen)
+    {
+      I_SetTruePalette(palette);
+      return;
+    }
+
   outportb(0x3c8,0);
   for (i=0;i<256;i++)
     {
@@ -312,9 +437,32 @@ void I_InitGraphics(void)
   if (!nodrawers) // killough 3/2/98: possibly avoid gfx mode
     {
       signal(SIGINT, SIG_IGN);  // ignore CTRL-C in graphics mode
-      set_color_depth(8);
-      set_gfx_mode(GFX_AUTODETECT, SCREENWIDTH, SCREENHEIGHT,
-                   SCREENWIDTH, SCREENHEIGHT);
+
+      // try for a truecolor mode if asked, else fall back on 8-bit
+
+      if (use_truecolor)
+        {
+          set_color_depth(32);
+          if (!set_gfx_mode(GFX_AUTODETECT, SCREENWIDTH, SCREENHEIGHT,
+                            SCREENWIDTH, SCREENHEIGHT))
+            {
+              if ((truescreen = create_bitmap_ex(32, SCREENWIDTH,
+                                                 SCREENHEIGHT)))
+                {
+                  lastscreen = malloc(SCREENWIDTH*SCREENHEIGHT);
+                  truerefresh = true;
+                }
+              else
+                lprintf(LO_WARN, "I_InitGraphics: no memory for a truecolor "
+                        "screen, using 8-bit color\n");
+            }
+        }
+      if (!truescreen)
+        {
+          set_color_depth(8);
+          set_gfx_mode(GFX_AUTODETECT, SCREENWIDTH, SCREENHEIGHT,
+                       SCREENWIDTH, SCREENHEIGHT);
+        }
       atexit(I_ShutdownGraphics);
     }
 
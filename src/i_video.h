@@ -58,6 +58,7 @@ int I_DoomCode2ScanCode(int);   // killough
 int I_ScanCode2DoomCode(int);   // killough
 
 extern int use_vsync;  // killough 2/8/98: controls whether vsync is called
+extern int use_truecolor;   // present frames through a 32-bit video mode
 
 #endif
 
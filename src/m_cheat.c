@@ -34,6 +34,7 @@ rcsid[] = "$Id: m_cheat.c,v 1.8 1998/08/14 19:51:45 jim Exp $";
 #include "g_game.h"
 #include "r_data.h"
 #include "p_inter.h"
+#include "p_tick.h"
 #include "m_cheat.h"
 #include "m_argv.h"
 #include "s_sound.h"
@@ -77,6 +78,7 @@ static void cheat_tntammo();
 static void cheat_tntammox();
 static void cheat_smart();
 static void cheat_pitch();
+static void cheat_mem();
 
 //-----------------------------------------------------------------------------
 //
@@ -238,6 +240,9 @@ struct cheat_s cheat[] = {
   {"tntpush",    NULL,                not_net | not_demo, 
    cheat_pushers    },   // phares 3/10/98: toggle pushers
 
+  {"tntmem",     NULL,                always,
+   cheat_mem        },   // dump zone memory statistics and map
+
   {NULL}                 // end-of-list marker
 };
 
@@ -473,12 +478,11 @@ static void cheat_massacre()    // jff 2/01/98 kill all monsters
   // fixed lost soul bug (LSs left behind when PEs are killed)
 
   int killcount=0;
-  thinker_t *currentthinker=&thinkercap;
+  thinker_t *cap = &mobjthinkercap, *currentthinker = cap;
   extern void A_PainDie(mobj_t *);
 
-  while ((currentthinker=currentthinker->next)!=&thinkercap)
-    if (currentthinker->function.acp1 == (actionf_p1) P_MobjThinker &&
-        (((mobj_t *) currentthinker)->flags & MF_COUNTKILL ||
+  while ((currentthinker=currentthinker->mnext)!=cap)
+    if ((((mobj_t *) currentthinker)->flags & MF_COUNTKILL ||
          ((mobj_t *) currentthinker)->type == MT_SKULL))
       { // killough 3/6/98: kill even if PE is dead
         if (((mobj_t *) currentthinker)->health > 0)
@@ -615,6 +619,12 @@ static void cheat_pitch()
     "Pitch Effects Disabled";
 }
 
+static void cheat_mem()
+{
+  plyr->message = Z_DumpStats("zonemap.txt") ?    // *not* externalized
+    "Zone Map Written To ZONEMAP.TXT" : "Unable To Write ZONEMAP.TXT";
+}
+
 //-----------------------------------------------------------------------------
 // 2/7/98: Cheat detection rewritten by Lee Killough, to avoid
 // scrambling and to use a more general table-driven approach.
@@ -936,6 +936,8 @@ void M_ReadSaveStrings(void)
   {
   int i;
 
+  G_FinishSaveGame();          // so that the files are up to date
+
   for (i = 0 ; i < load_end ; i++)
     {
     int handle;
@@ -49,6 +49,7 @@ rcsid[] = "$Id: m_misc.c,v 1.62 1998/09/07 20:19:07 jim Exp $";
 #include "s_sound.h"
 #include "sounds.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
+#include "m_png.h"
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -155,6 +156,7 @@ int usejoystick;
 
 //jff 3/30/98
 int screenshot_pcx;      // option to output screenshot as pcx or bmp
+int screenshot_png;      // option to output screenshot as png, over the above
 
 extern int mousebfire;
 extern int mousebstrafe;
@@ -173,8 +175,11 @@ extern int mouseSensitivity_horiz,mouseSensitivity_vert;  // killough
 extern int realtic_clock_rate;         // killough 4/13/98: adjustable timer
 extern int leds_always_off;            // killough 3/6/98
 extern int tran_filter_pct;            // killough 2/21/98
+extern int thing_grid_size;
 
 extern int screenblocks;
+extern int auto_viewsize, auto_viewsize_ms;
+extern int uncapped_framerate;
 extern int showMessages;
 
 extern boolean pause_init;             //jff 8/3/98 logical output controls
@@ -209,10 +214,17 @@ default_t defaults[] =
      0,1,0,ss_none,   "[0/1(1)] 1 enables voice detection prior to calling install sound"},  
     {"use_vsync",  &use_vsync, 1,             // killough 2/8/98
      0,1,0,ss_none,    "[0/1(1)] 1 to enable wait for vsync to avoid display tearing"},
+    {"use_truecolor",  &use_truecolor, 0,
+     0,1,0,ss_none,    "[0/1(0)] 1 to show frames through a 32-bit video mode, if there is one"},
+    {"uncapped_framerate",  &uncapped_framerate, 0,
+     0,1,0,ss_none,    "[0/1(0)] 1 to draw frames as fast as possible, moving things smoothly between tics"},
 
     {"realtic_clock_rate", &realtic_clock_rate, 100,
      10,1000,0,ss_none, "[10/1000(100)] Percentage of normal speed (35 fps) realtic clock runs at"},
 
+    {"zone_cache_budget", &zone_cache_budget, 0,
+     0,UL,0,ss_none, "[0-?(0)] KB of cached graphics kept in memory, oldest evicted first (0 = no limit)"},
+
     {"pitched_sounds", &default_pitched_sounds, 0,
      0,1,0,ss_none,   "[0/1(0)] 1 to enable variable pitch in sound effects (from id's original code)"}, // killough 2/21/98
 
@@ -223,9 +235,17 @@ default_t defaults[] =
     {"max_player_corpse", &bodyquesize, 32,   // killough 2/8/98
      UL,UL,0,ss_none,   "[?-?(32)] number of dead bodies in view supported (negative value = no limit)"},
 
+    {"thing_grid_size", &thing_grid_size, 32,
+     0,128,0,ss_none, "[0-128(32)] cell size of the grid things are found by for collisions (0 = blockmap only)"},
+
     {"demo_insurance",   &default_demo_insurance, 2,   // killough 3/31/98
      0,2,0,ss_none,      "[0-2(2)] 1=take special steps ensuring demo sync, 2=only during recordings"},
 
+    {"demo_snapshots",   &demo_snapshots, 16,
+     0,256,0,ss_none,    "[0-256(16)] most snapshots kept in memory for winding demos back (0 = none)"},
+    {"demo_snapshot_secs", &demo_snapshot_secs, 10,
+     1,3600,0,ss_none,   "[1-3600(10)] seconds of demo between snapshots, doubled whenever they run out"},
+
 // phares 3/10/98: replaced with cheat code
 //    {"variable_friction",&default_variable_friction, 1,
 //     0,1,0,   "[0/1(1)] 1 to enable icy and sludgy floors"},        // phares
@@ -284,6 +304,12 @@ default_t defaults[] =
 
 //    {"detaillevel",&detailLevel, 0},   // obsolete -- killough
 
+    {"auto_viewsize",&auto_viewsize, 0,
+     0,1,0,ss_none,    "[0/1(0)] 1 to shrink the play screen while it takes too long to draw"},
+
+    {"auto_viewsize_ms",&auto_viewsize_ms, 20,
+     1,1000,0,ss_none, "[1-1000(20)] milliseconds the view may take to draw with auto_viewsize"},
+
     {"usegamma",&usegamma, 3, //jff 3/6/98 fix erroneous upper limit in range
      0,4,0,ss_none,    "[0-4(3)] screen brightness (gamma correction)"},    // killough 1/18/98
 
@@ -369,6 +395,10 @@ default_t defaults[] =
      0,255,0,ss_keys,   "[0-255(88)] key to view from another player's vantage"},
     {"key_pause",        &key_pause,           KEYD_PAUSE     ,
      0,255,0,ss_keys,   "[0-255(127)] key to pause the game"},
+    {"key_demorewind",   &key_demorewind,      '['            ,
+     0,255,0,ss_keys,   "[0-255(26)] key to wind a playing demo back 10 seconds"},
+    {"key_demoforward",  &key_demoforward,     ']'            ,
+     0,255,0,ss_keys,   "[0-255(27)] key to wind a playing demo forward 10 seconds"},
     {"key_autorun",      &key_autorun,         KEYD_CAPSLOCK  ,
      0,255,0,ss_keys,   "[0-255(58)] key to toggle always run mode"},
     {"key_chat",         &key_chat,            't'            ,
@@ -442,6 +472,8 @@ default_t defaults[] =
     // jff 3/30/98 add ability to take screenshots in BMP format
     {"screenshot_pcx",   &screenshot_pcx,       1            ,
      0,255,0,ss_none,   "[0/1(1)] 1 to take a screenshot in PCX format, 0 for BMP"}, 
+    {"screenshot_png",   &screenshot_png,       1            ,
+     0,1,0,ss_none,     "[0/1(1)] 1 to take screenshots in PNG format, written in the background"},
 
 #ifdef LINUX
     {"mousedev", (int*)&mousedev, (int)"/dev/ttyS0",
@@ -1000,10 +1032,78 @@ void WriteBMPfile(char* filename,byte* data,int width,int height,byte* palette)
 //
 // Modified by Lee Killough so that any number of shots can be taken,
 // the code is faster, and no annoying "screenshot" message appears.
+//
+// Shots are numbered from an index file, which keeps the number of the
+// next one, rather than by looking for a free name each time. Only if it
+// is missing is the first free name looked for. Past DOOM9999 the names
+// go on as D0010000 and so on.
+//
+// PNG shots are copied into a queue, with the palette, and encoded a
+// piece each frame by M_WriteScreenShots, so that taking a burst of them
+// does not hold up the game. Any still queued are finished at exit.
+
+#define SHOTINDEX  "SCREENSH.IDX"
+#define SHOTQUEUE  16             // most shots waiting to be written
+#define SHOTBUDGET 8192           // bytes of a shot encoded each frame
+
+typedef struct
+  {
+  char name[16];
+  png_t *png;
+  } shot_t;
+
+static shot_t shotqueue[SHOTQUEUE];
+static int shothead, numshots;
+static int nextshot = -1;         // number of the next shot, -1 if unknown
+
+static void M_ShotName(char *name, int shot)
+  {
+  sprintf(name, shot < 10000 ? "DOOM%04d.%s" : "D%07d.%s", shot,
+          screenshot_png ? "PNG" : screenshot_pcx ? "PCX" : "BMP");
+  }
+
+static void M_SaveShotIndex(void)
+  {
+  FILE *st = fopen(SHOTINDEX, "w");
+  if (st)
+    {
+    fprintf(st, "%d\n", nextshot);
+    fclose(st);
+    }
+  }
+
+// Writes out the first shot in the queue, which has been encoded
+
+static void M_SaveQueuedShot(void)
+  {
+  shot_t *shot = &shotqueue[shothead];
+  int length;
+  const byte *data = M_PNGData(shot->png, &length);
+
+  if (!M_WriteFile(shot->name, (void *) data, length))
+    dprintf("M_ScreenShot: Couldn't write %s", shot->name);
+  M_FreePNG(shot->png);
+  shothead = (shothead + 1) % SHOTQUEUE;
+  numshots--;
+  }
+
+static void M_FlushScreenShots(void)
+  {
+  while (numshots)
+    {
+    M_EncodePNG(shotqueue[shothead].png, MAXINT);
+    M_SaveQueuedShot();
+    }
+  }
+
+void M_WriteScreenShots(void)
+  {
+  if (numshots && M_EncodePNG(shotqueue[shothead].png, SHOTBUDGET))
+    M_SaveQueuedShot();
+  }
 
 void M_ScreenShot (void)
   {
-  static int shot;
   char lbmname[32];
 
   // munge planar buffer to linear
@@ -1018,19 +1118,62 @@ void M_ScreenShot (void)
     return;
     }
 
-  do                                         //jff 3/30/98 pcx or bmp?  
-    sprintf(lbmname,"DOOM%02d.%.3s", shot++,screenshot_pcx? "PCX":"BMP");
-  while (!access(lbmname,0));
+  if (nextshot < 0)
+    {
+    FILE *st = fopen(SHOTINDEX, "r");
+    if (!st || fscanf(st, "%d", &nextshot) != 1 || nextshot < 0)
+      {
+      nextshot = 0;
+      for (;;)
+        {
+        M_ShotName(lbmname, nextshot);
+        if (access(lbmname,0))
+          break;
+        nextshot++;
+        }
+      }
+    if (st)
+      fclose(st);
+    }
+
+  M_ShotName(lbmname, nextshot++);       //jff 3/30/98 pcx or bmp?
+  M_SaveShotIndex();
 
   // killough 4/18/98: make palette stay around (PU_CACHE could cause crash)
 
   pal = W_CacheLumpName ("PLAYPAL", PU_STATIC);
     
-  // save the pcx file
-  //jff 3/30/98 write pcx or bmp depending on mode
+  if (screenshot_png)
+    {
+    static boolean flushatexit;
+    byte rgb[768];
+    int i;
+
+    if (numshots == SHOTQUEUE)          // finish the oldest now
+      {
+      M_EncodePNG(shotqueue[shothead].png, MAXINT);
+      M_SaveQueuedShot();
+      }
+
+    for (i = 0 ; i < 768 ; i++)
+      rgb[i] = gammatable[usegamma][pal[i]];
+
+    i = (shothead + numshots++) % SHOTQUEUE;
+    strcpy(shotqueue[i].name, lbmname);
+    shotqueue[i].png = M_StartPNG(linear, SCREENWIDTH, SCREENHEIGHT, rgb);
+
+    if (!flushatexit)
+      {
+      flushatexit = true;
+      atexit(M_FlushScreenShots);
+      }
+    }
+  else
+    // save the pcx file
+    //jff 3/30/98 write pcx or bmp depending on mode
 
-  (screenshot_pcx ? WritePCXfile : WriteBMPfile)
-    (lbmname, linear, SCREENWIDTH, SCREENHEIGHT, pal);
+    (screenshot_pcx ? WritePCXfile : WriteBMPfile)
+      (lbmname, linear, SCREENWIDTH, SCREENHEIGHT, pal);
 
   // killough 4/18/98: now you can mark it PU_CACHE
 
@@ -45,6 +45,8 @@ int M_ReadFile (char const* name,byte** buffer);
 
 void M_ScreenShot (void);
 
+void M_WriteScreenShots (void);   // a piece of any shots waiting, each frame
+
 void M_LoadDefaults (void);
 
 void M_SaveDefaults (void);
@@ -0,0 +1,156 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id: m_pack.c $
+//
+//  BOOM, a modified and improved DOOM engine
+//  Copyright (C) 1999 by
+//  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+//
+// DESCRIPTION:
+//      Fast LZ77 compression of memory blocks, for savegames.
+//
+//      The packed data is a sequence of control bytes, each followed by
+//      its operands. A control byte c below 32 is followed by c+1 literal
+//      bytes. Otherwise it is a copy of earlier output: its top 3 bits
+//      are the length less 2 (7 meaning a byte follows to add to it),
+//      and its low 5 bits and the next byte are the distance back less 1.
+//      Only single bytes are read and written, so there are no alignment
+//      or byte order concerns.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "m_pack.h"
+
+#define MAXLITERAL   32
+#define MAXDISTANCE  (1<<13)
+#define MAXCOPY      (2+7+255)
+#define HASHBITS     13
+
+#define HASH(p) \
+  ((((p)[0]<<16 | (p)[1]<<8 | (p)[2]) * 2654435761u) >> (32-HASHBITS) & \
+   ((1<<HASHBITS)-1))
+
+// Puts the literals from p to e, in runs of at most MAXLITERAL.
+
+static byte *M_PackLiterals(byte *op, const byte *oend,
+                            const byte *p, const byte *e)
+{
+  while (p < e)
+    {
+      int n = e - p > MAXLITERAL ? MAXLITERAL : e - p;
+      if (oend - op < n+1)
+        return NULL;
+      *op++ = n-1;
+      memcpy(op, p, n);
+      op += n;
+      p += n;
+    }
+  return op;
+}
+
+size_t M_Pack(const byte *in, size_t len, byte *out, size_t outlen)
+{
+  static const byte *hashtable[1<<HASHBITS];
+  const byte *ip = in, *iend = in + len, *literals = in;
+  byte *op = out, *oend = out + outlen;
+
+  memset(hashtable, 0, sizeof hashtable);
+
+  while (iend - ip >= 3)
+    {
+      const byte **h = &hashtable[HASH(ip)], *ref = *h;
+      *h = ip;
+
+      if (ref && ip - ref <= MAXDISTANCE &&
+          ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+        {
+          int n = 3, max = iend - ip > MAXCOPY ? MAXCOPY : iend - ip;
+          int dist = ip - ref - 1;
+
+          while (n < max && ref[n] == ip[n])
+            n++;
+
+          if (!(op = M_PackLiterals(op, oend, literals, ip)) || oend-op < 3)
+            return 0;
+
+          if (n-2 < 7)
+            *op++ = (n-2)<<5 | dist>>8;
+          else
+            {
+              *op++ = 7<<5 | dist>>8;
+              *op++ = n-2-7;
+            }
+          *op++ = dist;
+
+          literals = ip += n;
+          if (iend - ip >= 3)        // so that runs are found cheaply
+            hashtable[HASH(ip-1)] = ip-1;
+        }
+      else
+        ip++;
+    }
+
+  return (op = M_PackLiterals(op, oend, literals, iend)) ? op - out : 0;
+}
+
+size_t M_Unpack(const byte *in, size_t len, byte *out, size_t outlen)
+{
+  const byte *ip = in, *iend = in + len;
+  byte *op = out, *oend = out + outlen;
+
+  while (ip < iend)
+    {
+      int c = *ip++;
+
+      if (c < MAXLITERAL)
+        {
+          if (iend - ip < c+1 || oend - op < c+1)
+            return 0;
+          memcpy(op, ip, c+1);
+          op += c+1;
+          ip += c+1;
+        }
+      else
+        {
+          int n = c>>5;
+          const byte *ref;
+
+          if (n == 7)
+            {
+              if (ip >= iend)
+                return 0;
+              n += *ip++;
+            }
+          if (ip >= iend)
+            return 0;
+          ref = op - ((c & 31)<<8 | *ip++) - 1;
+          n += 2;
+
+          if (ref < out || oend - op < n)
+            return 0;
+          while (n--)                // may overlap, so byte by byte
+            *op++ = *ref++;
+        }
+    }
+
+  return op - out;
+}
+
+//----------------------------------------------------------------------------
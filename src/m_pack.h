@@ -0,0 +1,43 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id: m_pack.h $
+//
+//  BOOM, a modified and improved DOOM engine
+//  Copyright (C) 1999 by
+//  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+//
+// DESCRIPTION:
+//      Fast LZ77 compression of memory blocks, for savegames.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __M_PACK__
+#define __M_PACK__
+
+#include "doomtype.h"
+
+// Both return the number of bytes put in out, or 0 if it would not fit
+// in outlen bytes (or, for M_Unpack, if the input is corrupt).
+
+size_t M_Pack(const byte *in, size_t len, byte *out, size_t outlen);
+size_t M_Unpack(const byte *in, size_t len, byte *out, size_t outlen);
+
+#endif
+
+//----------------------------------------------------------------------------
@@ -0,0 +1,390 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id: m_png.c $
+//
+//  BOOM, a modified and improved DOOM engine
+//  Copyright (C) 1999 by
+//  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+//
+// DESCRIPTION:
+//      PNG encoding of 256 color images, a piece at a time.
+//
+//      Images are written as 8-bit paletted PNGs, each row unfiltered,
+//      which suits the game's graphics best. The pixels are compressed
+//      by a small deflate encoder: LZ77 over the image, found through
+//      hash chains a few links deep, coded with the fixed Huffman codes
+//      as a single block. This gets most of what a full encoder would
+//      on screenshots, in little code and time.
+//
+//      The encoding can be spread out, a budget of bytes at a time, so
+//      that it fits between frames. Until it starts, only the image and
+//      its palette are held; the output buffer and the hash chains are
+//      allocated then, and the chains and image freed when it is done,
+//      so that images waiting their turn cost little memory.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "m_png.h"
+
+#define HASHBITS   13
+#define HASHSIZE   (1<<HASHBITS)
+#define WINDOW     32768        // deflate's window, a power of 2
+#define MAXCHAIN   16           // most earlier matches tried at a position
+#define MINMATCH   3
+#define MAXMATCH   258
+
+// Bytes before the compressed data: the signature, IHDR, PLTE and the
+// length and type of IDAT.
+
+#define PNGHEADER  (8 + 25 + 12+768 + 8)
+
+struct png_s {
+  byte *in;                     // the rows, each led by its filter byte
+  int len, pos;                 // bytes in in, and bytes encoded
+  int width, height;
+  byte palette[768];
+  byte *out;                    // the PNG file, NULL until encoding starts
+  int outlen;
+  unsigned long bits;           // bits not yet put in out, lowest first
+  int nbits;
+  unsigned long adler;          // of the bytes encoded
+  int *head;                    // last position of each hash, or -1
+  int *prev;                    // earlier position of a position's hash
+};
+
+static const int lenbase[29] = {
+  3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,
+  131,163,195,227,258
+};
+static const int lenextra[29] = {
+  0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0
+};
+static const int distbase[30] = {
+  1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,
+  2049,3073,4097,6145,8193,12289,16385,24577
+};
+static const int distextra[30] = {
+  0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13
+};
+
+//
+// Checksums
+//
+
+static unsigned long M_CRC(unsigned long crc, const byte *p, int len)
+{
+  static unsigned long crctable[256];
+
+  if (!crctable[1])
+    {
+      int i, j;
+      for (i = 0; i < 256; i++)
+        {
+          unsigned long c = i;
+          for (j = 0; j < 8; j++)
+            c = c & 1 ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+          crctable[i] = c;
+        }
+    }
+
+  crc ^= 0xffffffffUL;
+  while (len--)
+    crc = crctable[(crc ^ *p++) & 255] ^ (crc >> 8);
+  return crc ^ 0xffffffffUL;
+}
+
+static unsigned long M_Adler(unsigned long adler, const byte *p, int len)
+{
+  unsigned long a = adler & 0xffff, b = adler >> 16;
+
+  while (len > 0)
+    {
+      int n = len < 5552 ? len : 5552;  // most bytes before b can overflow
+      len -= n;
+      while (n--)
+        b += a += *p++;
+      a %= 65521;
+      b %= 65521;
+    }
+  return b << 16 | a;
+}
+
+//
+// Output
+//
+
+static void M_PutLong(byte *p, unsigned long n)     // big endian
+{
+  p[0] = n >> 24;
+  p[1] = n >> 16;
+  p[2] = n >> 8;
+  p[3] = n;
+}
+
+// Ends a chunk whose 8 bytes of length and type are at out+start
+
+static void M_EndChunk(png_t *png, int start)
+{
+  int len = png->outlen - start - 8;
+
+  M_PutLong(png->out + start, len);
+  M_PutLong(png->out + png->outlen,
+            M_CRC(0, png->out + start + 4, len + 4));
+  png->outlen += 4;
+}
+
+static void M_StartChunk(png_t *png, const char *type)
+{
+  memcpy(png->out + png->outlen + 4, type, 4);
+  png->outlen += 8;
+}
+
+static void M_PutBits(png_t *png, unsigned long value, int n)
+{
+  png->bits |= value << png->nbits;
+  png->nbits += n;
+  while (png->nbits >= 8)
+    {
+      png->out[png->outlen++] = png->bits;
+      png->bits >>= 8;
+      png->nbits -= 8;
+    }
+}
+
+// Huffman codes go highest bit first
+
+static void M_PutCode(png_t *png, int code, int n)
+{
+  int r = 0, i;
+
+  for (i = 0; i < n; i++, code >>= 1)
+    r = r << 1 | (code & 1);
+  M_PutBits(png, r, n);
+}
+
+static void M_PutSymbol(png_t *png, int sym)
+{
+  if (sym < 144)
+    M_PutCode(png, 0x30 + sym, 8);
+  else
+    if (sym < 256)
+      M_PutCode(png, 0x190 + sym - 144, 9);
+    else
+      if (sym < 280)
+        M_PutCode(png, sym - 256, 7);
+      else
+        M_PutCode(png, 0xc0 + sym - 280, 8);
+}
+
+static void M_PutMatch(png_t *png, int len, int dist)
+{
+  int i = 28, j = 29;
+
+  while (lenbase[i] > len)
+    i--;
+  M_PutSymbol(png, 257 + i);
+  M_PutBits(png, len - lenbase[i], lenextra[i]);
+
+  while (distbase[j] > dist)
+    j--;
+  M_PutCode(png, j, 5);
+  M_PutBits(png, dist - distbase[j], distextra[j]);
+}
+
+//
+// Encoding
+//
+
+#define HASH(p) (((p)[0] << 10 ^ (p)[1] << 5 ^ (p)[2]) & (HASHSIZE-1))
+
+static void M_InsertHash(png_t *png, int pos)
+{
+  if (pos + MINMATCH <= png->len)
+    {
+      int h = HASH(png->in + pos);
+      png->prev[pos & (WINDOW-1)] = png->head[h];
+      png->head[h] = pos;
+    }
+}
+
+// Finds the longest match for the bytes at pos, returning its length
+// (0 if none) and putting its distance back in *dist
+
+static int M_FindMatch(const png_t *png, int pos, int *dist)
+{
+  const byte *in = png->in, *p = in + pos;
+  int best = 0, chain = MAXCHAIN, maxlen = png->len - pos, cand;
+
+  if (maxlen < MINMATCH)
+    return 0;
+  if (maxlen > MAXMATCH)
+    maxlen = MAXMATCH;
+
+  // a position's prev entry holds until WINDOW positions after it
+  for (cand = png->head[HASH(p)];
+       cand >= 0 && pos - cand < WINDOW && chain--;
+       cand = png->prev[cand & (WINDOW-1)])
+    if (in[cand + best] == p[best])
+      {
+        int n = 0;
+        while (n < maxlen && in[cand + n] == p[n])
+          n++;
+        if (n > best)
+          {
+            best = n;
+            *dist = pos - cand;
+            if (n == maxlen)
+              break;
+          }
+      }
+
+  return best >= MINMATCH ? best : 0;
+}
+
+png_t *M_StartPNG(const byte *data, int width, int height, const byte *palette)
+{
+  png_t *png = Z_Malloc(sizeof *png, PU_STATIC, 0);
+  byte *p;
+  int y;
+
+  png->len = height * (width + 1);
+  png->in = p = Z_Malloc(png->len, PU_STATIC, 0);
+  for (y = 0; y < height; y++, data += width, p += width)
+    {
+      *p++ = 0;                                 // no filter
+      memcpy(p, data, width);
+    }
+
+  png->width = width;
+  png->height = height;
+  memcpy(png->palette, palette, sizeof png->palette);
+  png->out = NULL;
+  png->head = png->prev = NULL;
+  return png;
+}
+
+// Allocates the output and hash chains, and writes everything up to the
+// compressed data
+
+static void M_BeginPNG(png_t *png)
+{
+  byte *p;
+
+  // Each byte takes at most 9 bits as a literal, and 31 bits cover a match
+  // of at least 3 bytes, so this bounds the compressed data.
+  png->out = Z_Malloc(PNGHEADER + png->len * 11/8 + 64, PU_STATIC, 0);
+
+  memcpy(png->out, "\x89PNG\r\n\x1a\n", 8);
+  png->outlen = 8;
+
+  M_StartChunk(png, "IHDR");
+  p = png->out + png->outlen;
+  M_PutLong(p, png->width);
+  M_PutLong(p+4, png->height);
+  p[8] = 8;                     // bits per pixel
+  p[9] = 3;                     // paletted
+  p[10] = p[11] = p[12] = 0;    // deflate, adaptive filtering, no interlace
+  png->outlen += 13;
+  M_EndChunk(png, 8);
+
+  M_StartChunk(png, "PLTE");
+  memcpy(png->out + png->outlen, png->palette, 768);
+  png->outlen += 768;
+  M_EndChunk(png, 8 + 25);
+
+  M_StartChunk(png, "IDAT");
+  png->out[png->outlen++] = 0x78;               // zlib header, 32K window
+  png->out[png->outlen++] = 0x01;
+  png->bits = png->nbits = 0;
+  M_PutBits(png, 3, 3);                         // the only block, fixed codes
+
+  png->pos = 0;
+  png->adler = 1;
+  png->head = Z_Malloc((HASHSIZE + WINDOW) * sizeof *png->head, PU_STATIC, 0);
+  png->prev = png->head + HASHSIZE;
+  memset(png->head, -1, HASHSIZE * sizeof *png->head);
+}
+
+boolean M_EncodePNG(png_t *png, int budget)
+{
+  int start, end;
+
+  if (!png->in)                                 // done already
+    return true;
+  if (!png->out)
+    M_BeginPNG(png);
+
+  start = png->pos;
+  end = png->len - start > budget ? start + budget : png->len;
+
+  while (png->pos < end)
+    {
+      int dist, len = M_FindMatch(png, png->pos, &dist);
+
+      if (len)
+        {
+          M_PutMatch(png, len, dist);
+          while (len--)
+            M_InsertHash(png, png->pos++);
+        }
+      else
+        {
+          M_PutSymbol(png, png->in[png->pos]);
+          M_InsertHash(png, png->pos++);
+        }
+    }
+
+  png->adler = M_Adler(png->adler, png->in + start, png->pos - start);
+
+  if (png->pos < png->len)
+    return false;
+
+  M_PutSymbol(png, 256);                        // end of block
+  if (png->nbits)
+    M_PutBits(png, 0, 8 - png->nbits);
+  M_PutLong(png->out + png->outlen, png->adler);
+  png->outlen += 4;
+  M_EndChunk(png, PNGHEADER - 8);
+
+  M_StartChunk(png, "IEND");
+  M_EndChunk(png, png->outlen - 8);
+
+  Z_Free(png->head);                            // only the PNG is needed now
+  Z_Free(png->in);
+  png->head = png->prev = NULL;
+  png->in = NULL;
+  return true;
+}
+
+const byte *M_PNGData(const png_t *png, int *length)
+{
+  *length = png->outlen;
+  return png->out;
+}
+
+void M_FreePNG(png_t *png)
+{
+  Z_Free(png->head);
+  Z_Free(png->in);
+  Z_Free(png->out);
+  Z_Free(png);
+}
+
+//----------------------------------------------------------------------------
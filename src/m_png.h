@@ -0,0 +1,50 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id: m_png.h $
+//
+//  BOOM, a modified and improved DOOM engine
+//  Copyright (C) 1999 by
+//  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+//
+// DESCRIPTION:
+//      PNG encoding of 256 color images, a piece at a time.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __M_PNG__
+#define __M_PNG__
+
+#include "doomtype.h"
+
+typedef struct png_s png_t;
+
+// Copies an image and its 768 byte RGB palette, to be encoded later
+png_t *M_StartPNG(const byte *data, int width, int height, const byte *palette);
+
+// Encodes about budget more bytes of the image; true once the PNG is done
+boolean M_EncodePNG(png_t *png, int budget);
+
+// The finished PNG file, valid until M_FreePNG
+const byte *M_PNGData(const png_t *png, int *length);
+
+void M_FreePNG(png_t *png);
+
+#endif
+
+//----------------------------------------------------------------------------
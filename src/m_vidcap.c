@@ -0,0 +1,287 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id: m_vidcap.c $
+//
+//  BOOM, a modified and improved DOOM engine
+//  Copyright (C) 1999 by
+//  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+//
+// DESCRIPTION:
+//      Writing a demo out as video and sound (-viddump).
+//
+//      The demo is played a tic a frame, with no waiting on the clock or
+//      the retrace, and each frame is converted through the palette to
+//      YUV 4:2:0 and appended to a YUV4MPEG2 stream, which most encoders
+//      read directly. The sound effects are mixed in software alongside
+//      Allegro's mixer, from the same calls, into a 16-bit stereo WAV
+//      file, a tic's worth of samples with each frame, so the two stay
+//      in step however fast the demo runs. Music is not written out.
+//
+//      Both files are written through large stdio buffers, and their
+//      headers are completed when the program exits.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include "doomstat.h"
+#include "v_video.h"
+#include "i_system.h"
+#include "m_swap.h"
+#include "m_vidcap.h"
+#include "lprintf.h"
+
+boolean vidcapture;             // a demo is being written out
+
+static FILE *vidfile, *sndfile;
+static int vidtic;              // the gametic of the last frame written
+static int vidframes;
+
+//
+// Video
+//
+
+static byte vidbuf[SCREENWIDTH*SCREENHEIGHT*3/2];  // Y plane, then U and V
+
+// The palette as JPEG (full range BT.601) luma, and chroma scaled by 2^16
+
+static byte ylut[256];
+static int ulut[256], vlut[256];
+
+void M_VidCapPalette(const byte *palette)
+{
+  int i;
+
+  for (i = 0; i < 256; i++, palette += 3)
+    {
+      int r = gammatable[usegamma][palette[0]];
+      int g = gammatable[usegamma][palette[1]];
+      int b = gammatable[usegamma][palette[2]];
+      ylut[i] = (19595*r + 38470*g + 7471*b + 32768) >> 16;
+      ulut[i] = -11059*r - 21709*g + 32768*b;
+      vlut[i] = 32768*r - 27439*g - 5329*b;
+    }
+}
+
+// Averages the chroma of a 2x2 block into an 8-bit sample
+
+static byte M_Chroma(const int *lut, const byte *src)
+{
+  int c = ((lut[src[0]] + lut[src[1]] +
+            lut[src[SCREENWIDTH]] + lut[src[SCREENWIDTH+1]] +
+            (1<<17)) >> 18) + 128;
+  return c < 0 ? 0 : c > 255 ? 255 : c;
+}
+
+static void M_WriteVideoFrame(void)
+{
+  const byte *src = screens[0];
+  byte *dest = vidbuf;
+  byte *u = vidbuf + SCREENWIDTH*SCREENHEIGHT;
+  byte *v = u + SCREENWIDTH*SCREENHEIGHT/4;
+  int i, x, y;
+
+  for (i = 0; i < SCREENWIDTH*SCREENHEIGHT; i++)
+    dest[i] = ylut[src[i]];
+
+  for (y = 0; y < SCREENHEIGHT; y += 2, src += SCREENWIDTH*2)
+    for (x = 0; x < SCREENWIDTH; x += 2)
+      {
+        *u++ = M_Chroma(ulut, src+x);
+        *v++ = M_Chroma(vlut, src+x);
+      }
+
+  if (fputs("FRAME\n", vidfile) == EOF ||
+      fwrite(vidbuf, sizeof vidbuf, 1, vidfile) != 1)
+    I_Error("Out of disk space writing video");
+}
+
+//
+// Sound
+//
+// The channels follow i_sound.c's by handle. Volume and pan are Allegro's,
+// 0 to 255, and pitch is Allegro's, 1000 being the sample's own rate.
+//
+
+#define VIDCAP_RATE      11025                  // the rate of most sfx
+#define VIDCAP_CHANNELS  256                    // as in i_sound.c
+#define SAMPLESPERTIC    (VIDCAP_RATE/TICRATE)  // 315
+
+typedef struct {
+  const byte *data;             // unsigned 8-bit samples, NULL if stopped
+  unsigned len;
+  unsigned freq;
+  unsigned long pos, step;      // 16.16 fixed point, in samples
+  int left, right;              // volume times pan for each side
+} vidchan_t;
+
+static vidchan_t vidchans[VIDCAP_CHANNELS];
+static short sndbuf[SAMPLESPERTIC*2];
+static unsigned long sndsamples;
+
+void M_VidCapSoundParams(int handle, int vol, int pan, int pitch)
+{
+  vidchan_t *c = &vidchans[handle];
+
+  if (pan < 0)
+    pan = 0;
+  else
+    if (pan > 255)
+      pan = 255;
+  c->left = vol * (255 - pan);
+  c->right = vol * pan;
+  c->step = ((long long) c->freq * pitch << FRACBITS) / (1000L*VIDCAP_RATE);
+}
+
+void M_VidCapStartSound(int handle, const byte *data, int len, int freq,
+                        int vol, int pan, int pitch)
+{
+  vidchan_t *c = &vidchans[handle];
+
+  c->data = data;
+  c->len = len;
+  c->freq = freq;
+  c->pos = 0;
+  M_VidCapSoundParams(handle, vol, pan, pitch);
+}
+
+void M_VidCapStopSound(int handle)
+{
+  vidchans[handle].data = NULL;
+}
+
+static void M_WriteSoundTic(void)
+{
+  static int mix[SAMPLESPERTIC*2];
+  vidchan_t *c;
+  int i;
+
+  memset(mix, 0, sizeof mix);
+
+  for (c = vidchans; c < vidchans + VIDCAP_CHANNELS; c++)
+    if (c->data)
+      for (i = 0; i < SAMPLESPERTIC; i++)
+        {
+          int s;
+          if (c->pos >> FRACBITS >= c->len)
+            {
+              c->data = NULL;
+              break;
+            }
+          s = c->data[c->pos >> FRACBITS] - 128;
+          c->pos += c->step;
+          mix[i*2  ] += s * c->left  >> 9;
+          mix[i*2+1] += s * c->right >> 9;
+        }
+
+  for (i = 0; i < SAMPLESPERTIC*2; i++)
+    sndbuf[i] = SHORT(mix[i] < -32768 ? -32768 : mix[i] > 32767 ? 32767 :
+                      mix[i]);
+
+  if (fwrite(sndbuf, sizeof sndbuf, 1, sndfile) != 1)
+    I_Error("Out of disk space writing sound");
+  sndsamples += SAMPLESPERTIC;
+}
+
+// The WAV header, with the sizes filled in from the number of samples
+
+static void M_WriteWavHeader(void)
+{
+  static const byte header[44] = {
+    'R','I','F','F', 0,0,0,0, 'W','A','V','E',
+    'f','m','t',' ', 16,0,0,0, 1,0, 2,0,                // PCM, stereo
+    VIDCAP_RATE & 255, VIDCAP_RATE >> 8, 0, 0,
+    (VIDCAP_RATE*4) & 255, (VIDCAP_RATE*4) >> 8 & 255, (VIDCAP_RATE*4) >> 16, 0,
+    4,0, 16,0,                                          // 16 bits
+    'd','a','t','a', 0,0,0,0
+  };
+  unsigned long size = sndsamples * 4;
+  byte buf[44];
+  int i;
+
+  memcpy(buf, header, sizeof buf);
+  for (i = 0; i < 4; i++)
+    {
+      buf[4+i] = (size + 36) >> i*8;
+      buf[40+i] = size >> i*8;
+    }
+  fwrite(buf, sizeof buf, 1, sndfile);
+}
+
+//
+// Capture
+//
+
+// One frame is written for each frame drawn after a tic has been run,
+// which with singletics is every frame. Tics run without drawing, as
+// with -skipsec or winding a demo on, are left out.
+
+void M_VidCapFrame(void)
+{
+  if (vidcapture && gametic != vidtic)
+    {
+      vidtic = gametic;
+      vidframes++;
+      M_WriteVideoFrame();
+      M_WriteSoundTic();
+    }
+}
+
+static void M_StopVidCap(void)
+{
+  if (!vidcapture)
+    return;
+  vidcapture = false;
+
+  fclose(vidfile);
+  rewind(sndfile);
+  M_WriteWavHeader();
+  fclose(sndfile);
+
+  lprintf(LO_INFO, "M_StopVidCap: %d frames written\n", vidframes);
+}
+
+void M_StartVidCap(const char *name)
+{
+  char *filename = malloc(strlen(name)+5);
+
+  sprintf(filename, "%s.y4m", name);
+  if (!(vidfile = fopen(filename, "wb")))
+    I_Error("Unable to create %s", filename);
+  setvbuf(vidfile, NULL, _IOFBF, sizeof vidbuf);
+  fprintf(vidfile, "YUV4MPEG2 W%d H%d F%d:1 Ip A5:6 C420jpeg XCOLORRANGE=FULL\n",
+          SCREENWIDTH, SCREENHEIGHT, TICRATE);
+
+  sprintf(filename, "%s.wav", name);
+  if (!(sndfile = fopen(filename, "wb")))
+    I_Error("Unable to create %s", filename);
+  setvbuf(sndfile, NULL, _IOFBF, sizeof sndbuf * 16);
+  M_WriteWavHeader();
+
+  free(filename);
+
+  vidcapture = true;
+  singletics = true;            // a tic each frame, as fast as they go
+  vidtic = gametic;
+  atexit(M_StopVidCap);
+
+  lprintf(LO_CONFIRM, "Writing video to %s.y4m and %s.wav\n", name, name);
+}
+
+//----------------------------------------------------------------------------
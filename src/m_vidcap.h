@@ -0,0 +1,54 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id: m_vidcap.h $
+//
+//  BOOM, a modified and improved DOOM engine
+//  Copyright (C) 1999 by
+//  id Software, Chi Hoang, Lee Killough, Jim Flynn, Rand Phares, Ty Halderman
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//  02111-1307, USA.
+//
+// DESCRIPTION:
+//      Writing a demo out as video and sound (-viddump).
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __M_VIDCAP__
+#define __M_VIDCAP__
+
+#include "doomtype.h"
+
+extern boolean vidcapture;      // a demo is being written out
+
+// Opens <name>.y4m and <name>.wav, and has the game run a tic a frame
+void M_StartVidCap(const char *name);
+
+// Writes out the frame in screens[0], and the sound, for each tic run
+void M_VidCapFrame(void);
+
+// Called with every palette set, to follow it in the video
+void M_VidCapPalette(const byte *palette);
+
+// Followers of the sound channels, called with the values given Allegro
+void M_VidCapStartSound(int handle, const byte *data, int len, int freq,
+                        int vol, int pan, int pitch);
+void M_VidCapSoundParams(int handle, int vol, int pan, int pitch);
+void M_VidCapStopSound(int handle);
+
+#endif
+
+//----------------------------------------------------------------------------
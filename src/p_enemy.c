@@ -44,6 +44,7 @@ rcsid[] = "$Id: p_enemy.c,v 1.23 1998/08/13 15:27:26 jim Exp $";
 #include "p_inter.h"
 #include "g_game.h"
 #include "p_enemy.h"
+#include "p_tick.h"
 
 typedef enum {
   DI_EAST,
@@ -491,13 +492,13 @@ void A_KeenDie(mobj_t* mo)
 
   // scan the remaining thinkers to see if all Keens are dead
 
-  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-    if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-      {
-        mobj_t *mo2 = (mobj_t *) th;
-        if (mo2 != mo && mo2->type == mo->type && mo2->health > 0)
-          return;                           // other Keen not dead
-      }
+  for (th = mobjthinkercap.mnext;
+       th != &mobjthinkercap; th=th->mnext)
+    {
+      mobj_t *mo2 = (mobj_t *) th;
+      if (mo2 != mo && mo2->type == mo->type && mo2->health > 0)
+        return;                           // other Keen not dead
+    }
 
   junk.tag = 666;
   EV_DoDoor(&junk,open);
@@ -1037,7 +1038,7 @@ void A_VileChase(mobj_t* actor)
               // Call PIT_VileCheck to check
               // whether object is a corpse
               // that canbe raised.
-              if (!P_BlockThingsIterator(bx,by,PIT_VileCheck))
+              if (!P_BlockCorpsesIterator(bx,by,PIT_VileCheck))
                 {
                   // got one!
                   temp = actor->target;
@@ -1059,6 +1060,7 @@ void A_VileChase(mobj_t* actor)
                       corpsehit->radius = info->radius; // fix Ghost bug
                     }                                               // phares
                   corpsehit->flags = info->flags;
+                  P_LinkCorpse(corpsehit);    // in case it still is one
                   corpsehit->health = info->spawnhealth;
                   corpsehit->target = NULL;
                   return;
@@ -1300,11 +1302,10 @@ void A_PainShootSkull(mobj_t *actor, angle_t angle)
       // count total number of skulls currently on the level
       int count = 0;
       thinker_t *currentthinker;
-      for (currentthinker = thinkercap.next;
-           currentthinker != &thinkercap;
-           currentthinker = currentthinker->next)
-        if ((currentthinker->function.acp1 == (actionf_p1) P_MobjThinker)
-            && ((mobj_t *)currentthinker)->type == MT_SKULL)
+      for (currentthinker = mobjthinkercap.mnext;
+           currentthinker != &mobjthinkercap;
+           currentthinker = currentthinker->mnext)
+        if (((mobj_t *)currentthinker)->type == MT_SKULL)
           count++;
       if (count > 20)                                               // phares
         return;                                                     // phares
@@ -1527,13 +1528,13 @@ void A_BossDeath(mobj_t *mo)
 
     // scan the remaining thinkers to see
     // if all bosses are dead
-  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-    if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-      {
-        mobj_t *mo2 = (mobj_t *) th;
-        if (mo2 != mo && mo2->type == mo->type && mo2->health > 0)
-          return;         // other boss not dead
-      }
+  for (th = mobjthinkercap.mnext;
+       th != &mobjthinkercap; th=th->mnext)
+    {
+      mobj_t *mo2 = (mobj_t *) th;
+      if (mo2 != mo && mo2->type == mo->type && mo2->health > 0)
+        return;         // other boss not dead
+    }
 
   // victory!
   if ( gamemode == commercial)
@@ -1641,22 +1642,21 @@ void P_SpawnBrainTargets(void)  // killough 3/26/98: renamed old function
   brain.targeton = 0;
   brain.easy = 0;           // killough 3/26/98: always init easy to 0
 
-  for (thinker = thinkercap.next ;
-       thinker != &thinkercap ;
-       thinker = thinker->next)
-    if (thinker->function.acp1 == (actionf_p1)P_MobjThinker)
-      {
-        mobj_t *m = (mobj_t *) thinker;
-
-        if (m->type == MT_BOSSTARGET )
-          {   // killough 2/7/98: remove limit on icon landings:
-            if (numbraintargets >= numbraintargets_alloc)
-              braintargets = realloc(braintargets,
-                      (numbraintargets_alloc = numbraintargets_alloc ?
-                       numbraintargets_alloc*2 : 32) *sizeof *braintargets);
-            braintargets[numbraintargets++] = m;
-          }
-      }
+  for (thinker = mobjthinkercap.mnext ;
+       thinker != &mobjthinkercap ;
+       thinker = thinker->mnext)
+    {
+      mobj_t *m = (mobj_t *) thinker;
+
+      if (m->type == MT_BOSSTARGET )
+        {   // killough 2/7/98: remove limit on icon landings:
+          if (numbraintargets >= numbraintargets_alloc)
+            braintargets = realloc(braintargets,
+                    (numbraintargets_alloc = numbraintargets_alloc ?
+                     numbraintargets_alloc*2 : 32) *sizeof *braintargets);
+          braintargets[numbraintargets++] = m;
+        }
+    }
 }
 
 void A_BrainAwake(mobj_t *mo)
@@ -38,6 +38,7 @@ rcsid[] = "$Id: p_inter.c,v 1.10 1998/05/03 23:09:29 killough Exp $";
 #include "s_sound.h"
 #include "sounds.h"
 #include "d_deh.h"  // Ty 03/22/98 - externalized strings
+#include "p_maputl.h"
 
 #ifdef __GNUG__
 #pragma implementation "p_inter.h"
@@ -617,6 +618,7 @@ void P_KillMobj(mobj_t *source, mobj_t *target)
     target->flags &= ~MF_NOGRAVITY;
 
   target->flags |= MF_CORPSE|MF_DROPOFF;
+  P_LinkCorpse(target);          // list it for Arch-viles
   target->height >>= 2;
 
   if (source && source->player)
@@ -708,6 +710,8 @@ void P_DamageMobj(mobj_t *target,mobj_t *inflictor, mobj_t *source, int damage)
   if (target->health <= 0)
     return;
 
+  P_WakeMobj(target);   // it is about to be pushed and change state
+
   if (target->flags & MF_SKULLFLY)
     target->momx = target->momy = target->momz = 0;
 
@@ -220,7 +220,7 @@ boolean P_TeleportMove (mobj_t* thing,fixed_t x,fixed_t y)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      if (!P_BlockThingsIterator(bx,by,PIT_StompThing))
+      if (!P_BlockThingsIteratorBox(bx,by,tmbbox,PIT_StompThing))
         return false;
 
   // the move is ok,
@@ -235,6 +235,8 @@ boolean P_TeleportMove (mobj_t* thing,fixed_t x,fixed_t y)
 
   P_SetThingPosition (thing);
 
+  thing->prevtic = -1;          // not to be drawn moving there
+
   return true;
   }
 
@@ -598,7 +600,7 @@ boolean P_CheckPosition (mobj_t* thing,fixed_t x,fixed_t y)
 
   for (bx=xl ; bx<=xh ; bx++)
     for (by=yl ; by<=yh ; by++)
-      if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+      if (!P_BlockThingsIteratorBox(bx,by,tmbbox,PIT_CheckThing))
         return false;
 
   // check lines
@@ -716,6 +718,11 @@ boolean P_ThingHeightClip (mobj_t* thing)
 
   P_CheckPosition (thing, thing->x, thing->y);
 
+  // A dormant thing has to think again if the sector moved under it
+
+  if (thing->floorz != tmfloorz || thing->ceilingz != tmceilingz)
+    P_WakeMobj(thing);
+
   // what about stranding a monster partially off an edge?
 
   thing->floorz = tmfloorz;
@@ -1512,6 +1519,12 @@ void P_RadiusAttack(mobj_t* spot,mobj_t* source,int damage)
   int yh;
 
   fixed_t dist;
+  fixed_t bbox[4];
+
+  bbox[BOXTOP] = spot->y + (damage<<FRACBITS);
+  bbox[BOXBOTTOM] = spot->y - (damage<<FRACBITS);
+  bbox[BOXRIGHT] = spot->x + (damage<<FRACBITS);
+  bbox[BOXLEFT] = spot->x - (damage<<FRACBITS);
 
   dist = (damage+MAXRADIUS)<<FRACBITS;
   yh = (spot->y + dist - bmaporgy)>>MAPBLOCKSHIFT;
@@ -1524,7 +1537,7 @@ void P_RadiusAttack(mobj_t* spot,mobj_t* source,int damage)
 
   for (y=yl ; y<=yh ; y++)
     for (x=xl ; x<=xh ; x++)
-      P_BlockThingsIterator (x, y, PIT_RadiusAttack );
+      P_BlockThingsIteratorBox (x, y, bbox, PIT_RadiusAttack );
   }
 
 
@@ -1850,10 +1863,61 @@ boolean PIT_GetSectors(line_t* ld)
   }
 
 
+//
+// PIT_GetClearance
+//
+// Narrows secnodemargin to how far tmbbox can grow before it touches the
+// line, as PIT_GetSectors sees it: either the line's bounding box or the
+// line itself has to be reached. Distances to the line are in whole units
+// and rounded down, to stay on the safe side.
+//
+
+#define SECNODEMARGIN (64*FRACUNIT)   // most secnodebox is made bigger
+
+static fixed_t secnodemargin;
+
+static boolean PIT_GetClearance(line_t* ld)
+  {
+  fixed_t m = ld->bbox[BOXLEFT] - tmbbox[BOXRIGHT];
+
+  if (m < tmbbox[BOXLEFT] - ld->bbox[BOXRIGHT])
+    m = tmbbox[BOXLEFT] - ld->bbox[BOXRIGHT];
+  if (m < ld->bbox[BOXBOTTOM] - tmbbox[BOXTOP])
+    m = ld->bbox[BOXBOTTOM] - tmbbox[BOXTOP];
+  if (m < tmbbox[BOXBOTTOM] - ld->bbox[BOXTOP])
+    m = tmbbox[BOXBOTTOM] - ld->bbox[BOXTOP];
+
+  if (m < secnodemargin)
+    {
+    int dx = ld->dx >> FRACBITS;
+    int dy = ld->dy >> FRACBITS;
+    if (dx || dy)
+      {
+      long long a = (long long)((tmx - ld->v1->x) >> FRACBITS) * dy -
+                    (long long)((tmy - ld->v1->y) >> FRACBITS) * dx;
+      int d = (a < 0 ? -a : a) / (abs(dx) + abs(dy))      // whole units
+              - (tmthing->radius >> FRACBITS) - 2;
+      fixed_t dm = d < SECNODEMARGIN >> FRACBITS ? d << FRACBITS :
+                   SECNODEMARGIN;
+      if (m < dm)
+        m = dm;
+      }
+    if (m < secnodemargin)
+      secnodemargin = m;
+    }
+  return secnodemargin > 0;
+  }
+
 // phares 3/14/98
 //
 // P_CreateSecNodeList alters/creates the sector_list that shows what sectors
 // the object resides in.
+//
+// A thing in a single sector, clear of its lines, usually stays that way
+// for many moves, and can be left in its list as it is while it stays in
+// its secnodebox. The box is found at each full rebuild from the lines
+// around the thing, and is only made if it has no lines in it at all, so
+// that skipping the rebuild cannot change the outcome.
 
 void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
   {
@@ -1865,6 +1929,25 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
   int by;
   msecnode_t* node;
 
+  tmthing = thing;
+  tmflags = thing->flags;
+
+  tmx = x;
+  tmy = y;
+
+  tmbbox[BOXTOP]  = y + tmthing->radius;
+  tmbbox[BOXBOTTOM] = y - tmthing->radius;
+  tmbbox[BOXRIGHT]  = x + tmthing->radius;
+  tmbbox[BOXLEFT]   = x - tmthing->radius;
+
+  if (sector_list && !sector_list->m_tnext &&
+      sector_list->m_sector == thing->subsector->sector &&
+      tmbbox[BOXLEFT]   > thing->secnodebox[BOXLEFT]  &&
+      tmbbox[BOXRIGHT]  < thing->secnodebox[BOXRIGHT] &&
+      tmbbox[BOXBOTTOM] > thing->secnodebox[BOXBOTTOM] &&
+      tmbbox[BOXTOP]    < thing->secnodebox[BOXTOP])
+    return;       // still just in the one sector, keep the node
+
   // First, clear out the existing m_thing fields. As each node is
   // added or verified as needed, m_thing will be set properly. When
   // finished, delete all nodes where m_thing is still NULL. These
@@ -1877,17 +1960,6 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
     node = node->m_tnext;
     }
 
-  tmthing = thing;
-  tmflags = thing->flags;
-
-  tmx = x;
-  tmy = y;
-
-  tmbbox[BOXTOP]  = y + tmthing->radius;
-  tmbbox[BOXBOTTOM] = y - tmthing->radius;
-  tmbbox[BOXRIGHT]  = x + tmthing->radius;
-  tmbbox[BOXLEFT]   = x - tmthing->radius;
-
   validcount++; // used to make sure we only process a line once
 
   xl = (tmbbox[BOXLEFT] - bmaporgx)>>MAPBLOCKSHIFT;
@@ -1918,6 +1990,33 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
     else
       node = node->m_tnext;
     }
+
+  // If the thing is in just the one sector, find how far its box can grow
+  // before it reaches a line, within SECNODEMARGIN.
+
+  thing->secnodebox[BOXLEFT] = thing->secnodebox[BOXRIGHT] = x;
+  thing->secnodebox[BOXBOTTOM] = thing->secnodebox[BOXTOP] = y;
+
+  if (sector_list->m_tnext)
+    return;
+
+  secnodemargin = SECNODEMARGIN;
+  validcount++;
+
+  xl = (tmbbox[BOXLEFT] - SECNODEMARGIN - bmaporgx)>>MAPBLOCKSHIFT;
+  xh = (tmbbox[BOXRIGHT] + SECNODEMARGIN - bmaporgx)>>MAPBLOCKSHIFT;
+  yl = (tmbbox[BOXBOTTOM] - SECNODEMARGIN - bmaporgy)>>MAPBLOCKSHIFT;
+  yh = (tmbbox[BOXTOP] + SECNODEMARGIN - bmaporgy)>>MAPBLOCKSHIFT;
+
+  for (bx=xl ; bx<=xh ; bx++)
+    for (by=yl ; by<=yh ; by++)
+      if (!P_BlockLinesIterator(bx,by,PIT_GetClearance))
+        return;
+
+  thing->secnodebox[BOXLEFT]   = tmbbox[BOXLEFT]   - secnodemargin;
+  thing->secnodebox[BOXRIGHT]  = tmbbox[BOXRIGHT]  + secnodemargin;
+  thing->secnodebox[BOXBOTTOM] = tmbbox[BOXBOTTOM] - secnodemargin;
+  thing->secnodebox[BOXTOP]    = tmbbox[BOXTOP]    + secnodemargin;
   }
 
 
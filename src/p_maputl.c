@@ -191,6 +191,194 @@ void P_LineOpening(line_t *linedef)
   openrange = opentop - openbottom;
 }
 
+//
+// THING GRID
+//
+// Things are indexed by a grid of cells finer than the blockmap's, for the
+// collision checks between things, so that in a crowd each thing is not
+// checked against everything in the blocks around it. The cells are a
+// power of two in size and aligned with the blocks, so each block is an
+// exact square of cells.
+//
+// The order in which things are checked matters for demo sync, so the
+// blockmap chains are kept as they were, and P_BlockThingsIteratorBox
+// visits a block's things in chain order. A block's chain is in reverse
+// order of linking, so each thing is stamped as it is linked in.
+//
+// Raisable corpses, things with MF_CORPSE whose type has a raisestate,
+// are also listed by block, for A_VileChase. Each list is kept in order
+// of stamp, oldest first, so that walking it backwards is chain order.
+//
+
+int thing_grid_size;              // config, 0 for the blockmap only
+
+typedef struct {
+  mobj_t **things;
+  int    numthings, maxthings;
+} thingcell_t;
+
+static thingcell_t *thinggrid;    // PU_LEVEL, NULL if not in use
+static int      thinggridshift;   // log2 of the cell size, in fixed point
+static int      thinggridwidth;
+static fixed_t  thinggridpad;     // most a thing can reach outside its cell
+static thingcell_t *corpselists;  // PU_LEVEL, one per block
+static unsigned lastblockstamp;   // stamp of the last thing linked
+
+//
+// P_InitThingGrid
+// Called by P_SetupLevel, once the blockmap is loaded.
+//
+
+void P_InitThingGrid(void)
+{
+  int i, size, count;
+
+  count = bmapwidth * bmapheight;
+  corpselists = Z_Malloc(count * sizeof *corpselists, PU_LEVEL, 0);
+  memset(corpselists, 0, count * sizeof *corpselists);
+
+  thinggrid = NULL;
+  lastblockstamp = 0;
+
+  if (thing_grid_size <= 0 || thing_grid_size >= MAPBLOCKUNITS)
+    return;
+
+  for (size = MAPBLOCKUNITS, thinggridshift = MAPBLOCKSHIFT;
+       size > 8 && size/2 >= thing_grid_size; size /= 2)
+    thinggridshift--;
+
+  thinggridwidth = bmapwidth << (MAPBLOCKSHIFT - thinggridshift);
+  count = thinggridwidth * (bmapheight << (MAPBLOCKSHIFT - thinggridshift));
+  thinggrid = Z_Malloc(count * sizeof *thinggrid, PU_LEVEL, 0);
+  memset(thinggrid, 0, count * sizeof *thinggrid);
+
+  // things never grow past their info's radius (see p_enemy.c and p_map.c)
+  for (thinggridpad = MAXRADIUS, i = 0; i < NUMMOBJTYPES; i++)
+    if (mobjinfo[i].radius > thinggridpad)
+      thinggridpad = mobjinfo[i].radius;
+  thinggridpad += FRACUNIT;
+}
+
+// Makes room for one more thing in a cell or corpse list.
+
+static void P_GrowCell(thingcell_t *cell)
+{
+  if (cell->numthings == cell->maxthings)
+    {
+      mobj_t **things = Z_Malloc((cell->maxthings = cell->maxthings ?
+                                  cell->maxthings*2 : 4) * sizeof *things,
+                                 PU_LEVEL, 0);
+      if (cell->things)
+        {
+          memcpy(things, cell->things, cell->numthings * sizeof *things);
+          Z_Free(cell->things);
+        }
+      cell->things = things;
+    }
+}
+
+static void P_LinkThingGrid(mobj_t *thing)
+{
+  thingcell_t *cell;
+  int cx = (thing->x - bmaporgx) >> thinggridshift;
+  int cy = (thing->y - bmaporgy) >> thinggridshift;
+
+  thing->gridcell = cy * thinggridwidth + cx;
+  P_GrowCell(cell = &thinggrid[thing->gridcell]);
+  thing->gridslot = cell->numthings;
+  cell->things[cell->numthings++] = thing;
+}
+
+static void P_UnlinkThingGrid(mobj_t *thing)
+{
+  if (thing->gridcell >= 0)
+    {
+      thingcell_t *cell = &thinggrid[thing->gridcell];
+      mobj_t *last = cell->things[--cell->numthings];
+      cell->things[last->gridslot = thing->gridslot] = last;
+      thing->gridcell = -1;
+    }
+}
+
+//
+// P_LinkCorpse
+//
+// Lists a thing as a raisable corpse, if it is one. Called as it is
+// linked into a block, and by P_KillMobj. Things which stop being corpses
+// are left listed until they are unlinked, as PIT_VileCheck skips them.
+//
+
+void P_LinkCorpse(mobj_t *thing)
+{
+  thingcell_t *list;
+  int blockx, blocky, i;
+
+  if (thing->corpseblock || !(thing->flags & MF_CORPSE) ||
+      thing->flags & MF_NOBLOCKMAP || thing->info->raisestate == S_NULL)
+    return;
+
+  blockx = (thing->x - bmaporgx)>>MAPBLOCKSHIFT;
+  blocky = (thing->y - bmaporgy)>>MAPBLOCKSHIFT;
+  if (blockx<0 || blockx >= bmapwidth || blocky<0 || blocky >= bmapheight)
+    return;
+
+  P_GrowCell(list = &corpselists[blocky*bmapwidth+blockx]);
+  for (i = list->numthings++; i > 0 &&
+         (int)(thing->blockstamp - list->things[i-1]->blockstamp) < 0; i--)
+    list->things[i] = list->things[i-1];
+  list->things[i] = thing;
+  thing->corpseblock = blocky*bmapwidth+blockx + 1;
+}
+
+static void P_UnlinkCorpse(mobj_t *thing)
+{
+  if (thing->corpseblock)
+    {
+      thingcell_t *list = &corpselists[thing->corpseblock - 1];
+      int i = list->numthings;
+      while (list->things[--i] != thing)
+        ;
+      memmove(list->things + i, list->things + i + 1,
+              (--list->numthings - i) * sizeof *list->things);
+      thing->corpseblock = 0;
+    }
+}
+
+//
+// P_RestampBlockChains
+//
+// Stamps the things in each block chain in chain order, for after the
+// chains have been put in an order of their own (see p_saveg.c). The head
+// of a chain is the last linked, so gets the newest stamp.
+//
+
+void P_RestampBlockChains(void)
+{
+  int i;
+
+  for (i = bmapwidth*bmapheight; --i >= 0; )
+    {
+      thingcell_t *list = &corpselists[i];
+      mobj_t *mobj;
+      unsigned n = 0, stamp;
+
+      for (mobj = blocklinks[i]; mobj; mobj = mobj->bnext)
+        n++;
+      stamp = lastblockstamp += n;
+      for (mobj = blocklinks[i]; mobj; mobj = mobj->bnext)
+        mobj->blockstamp = stamp--;
+
+      // and put the corpses back in order, oldest first, which is by
+      // stamp as P_LinkCorpse keeps them
+      list->numthings = 0;
+      for (mobj = blocklinks[i]; mobj; mobj = mobj->bnext)
+        if (mobj->corpseblock)
+          list->things[list->maxthings - ++list->numthings] = mobj;
+      memmove(list->things, list->things + list->maxthings - list->numthings,
+              list->numthings * sizeof *list->things);
+    }
+}
+
 //
 // THING POSITION SETTING
 //
@@ -251,6 +439,9 @@ void P_UnsetThingPosition (mobj_t *thing)
               blocky>=0 && blocky <bmapheight)
             blocklinks[blocky*bmapwidth+blockx] = thing->bnext;
         }
+
+      P_UnlinkThingGrid(thing);
+      P_UnlinkCorpse(thing);
     }
 }
 
@@ -310,9 +501,20 @@ void P_SetThingPosition(mobj_t *thing)
           if (*link)
             (*link)->bprev = thing;
           *link = thing;
+          thing->blockstamp = ++lastblockstamp;
+
+          if (thinggrid)
+            P_LinkThingGrid(thing);
+          else
+            thing->gridcell = -1;
+
+          P_LinkCorpse(thing);
         }
       else        // thing is off the map
-        thing->bnext = thing->bprev = NULL;
+        {
+          thing->bnext = thing->bprev = NULL;
+          thing->gridcell = -1;
+        }
     }
 }
 
@@ -415,6 +617,128 @@ boolean P_BlockThingsIterator(int x, int y, boolean func(mobj_t*))
   return true;
 }
 
+//
+// P_BlockThingsIteratorBox
+//
+// Like P_BlockThingsIterator, in the same order, but leaves out things
+// which are too far away to touch bbox, using the thing grid. Those are
+// ones which the PIT_* functions used with it would skip anyway.
+//
+// The things are gathered before any are visited, and since func may link
+// and unlink things, each is visited only if it has stayed put; a thing
+// which has moved has gone to the head of some chain, and is either not
+// visited in chain order or will be found again in a later block.
+//
+
+typedef struct {
+  mobj_t   *mobj;
+  unsigned stamp;
+} gridhit_t;
+
+static gridhit_t *gridhits;       // a stack, as func may iterate too
+static int      gridhitstop, maxgridhits;
+
+boolean P_BlockThingsIteratorBox(int x, int y, const fixed_t *bbox,
+                                 boolean func(mobj_t*))
+{
+  int cxl, cxh, cyl, cyh, cx, cy, i, base, top, shift;
+
+  if (!thinggrid)
+    return P_BlockThingsIterator(x, y, func);
+
+  if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+    return true;
+
+  // the cells of block x,y which things touching bbox may be in
+
+  shift = MAPBLOCKSHIFT - thinggridshift;
+  cxl = (bbox[BOXLEFT] - thinggridpad - bmaporgx) >> thinggridshift;
+  cxh = (bbox[BOXRIGHT] + thinggridpad - bmaporgx) >> thinggridshift;
+  cyl = (bbox[BOXBOTTOM] - thinggridpad - bmaporgy) >> thinggridshift;
+  cyh = (bbox[BOXTOP] + thinggridpad - bmaporgy) >> thinggridshift;
+  if (cxl < x << shift)
+    cxl = x << shift;
+  if (cxh > ((x+1) << shift) - 1)
+    cxh = ((x+1) << shift) - 1;
+  if (cyl < y << shift)
+    cyl = y << shift;
+  if (cyh > ((y+1) << shift) - 1)
+    cyh = ((y+1) << shift) - 1;
+
+  // gather them, newest stamp (head of the chain) first
+
+  base = i = gridhitstop;
+  for (cy = cyl; cy <= cyh; cy++)
+    for (cx = cxl; cx <= cxh; cx++)
+      {
+        const thingcell_t *cell = &thinggrid[cy * thinggridwidth + cx];
+        int j;
+        for (j = 0; j < cell->numthings; j++)
+          {
+            mobj_t *mobj = cell->things[j];
+            int k;
+            if (i == maxgridhits)
+              gridhits = realloc(gridhits, (maxgridhits = maxgridhits ?
+                                 maxgridhits*2 : 64) * sizeof *gridhits);
+            for (k = i++; k > base &&
+                   (int)(mobj->blockstamp - gridhits[k-1].stamp) > 0; k--)
+              gridhits[k] = gridhits[k-1];
+            gridhits[k].mobj = mobj;
+            gridhits[k].stamp = mobj->blockstamp;
+          }
+      }
+
+  for (top = gridhitstop = i, i = base; i < top; i++)
+    {
+      mobj_t *mobj = gridhits[i].mobj;
+      if (mobj->gridcell >= 0 && mobj->blockstamp == gridhits[i].stamp &&
+          !func(mobj))
+        break;
+    }
+
+  gridhitstop = base;
+  return i == top;
+}
+
+//
+// P_BlockCorpsesIterator
+//
+// Like P_BlockThingsIterator, in the same order, but visits only the
+// things listed as raisable corpses. Some of those may have been raised
+// since, which func must check for, as PIT_VileCheck does.
+//
+
+boolean P_BlockCorpsesIterator(int x, int y, boolean func(mobj_t*))
+{
+  if (!(x<0 || y<0 || x>=bmapwidth || y>=bmapheight))
+    {
+      thingcell_t *list = &corpselists[y*bmapwidth+x];
+      int i;
+
+#ifdef RANGECHECK
+      // The list is in order of stamp, which must be reverse chain order,
+      // so that corpses are found as a blockmap walk would find them,
+      // including after a load or a seek.
+      mobj_t *mobj;
+      for (mobj = blocklinks[y*bmapwidth+x]; mobj && mobj->bnext;
+           mobj = mobj->bnext)
+        if ((int)(mobj->blockstamp - mobj->bnext->blockstamp) <= 0)
+          I_Error("P_BlockCorpsesIterator: block %d,%d stamped out of order",
+                  x, y);
+      for (i = 1; i < list->numthings; i++)
+        if ((int)(list->things[i]->blockstamp -
+                  list->things[i-1]->blockstamp) <= 0)
+          I_Error("P_BlockCorpsesIterator: corpses of block %d,%d out of "
+                  "order", x, y);
+#endif
+
+      for (i = list->numthings; --i >= 0; )
+        if (!func(list->things[i]))
+          return false;
+    }
+  return true;
+}
+
 //
 // INTERCEPT ROUTINES
 //
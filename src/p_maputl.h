@@ -72,6 +72,12 @@ void    P_UnsetThingPosition(mobj_t *thing);
 void    P_SetThingPosition(mobj_t *thing);
 boolean P_BlockLinesIterator (int x, int y, boolean func(line_t *));
 boolean P_BlockThingsIterator(int x, int y, boolean func(mobj_t *));
+boolean P_BlockThingsIteratorBox(int x, int y, const fixed_t *bbox,
+                                 boolean func(mobj_t *));
+boolean P_BlockCorpsesIterator(int x, int y, boolean func(mobj_t *));
+void    P_InitThingGrid(void);
+void    P_LinkCorpse(mobj_t *thing);
+void    P_RestampBlockChains(void);
 boolean ThingIsOnLine(mobj_t *t, line_t *l);  // killough 3/15/98
 boolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
                        int flags, boolean trav(intercept_t *));
@@ -82,6 +88,8 @@ extern fixed_t openrange;
 extern fixed_t lowfloor;
 extern divline_t trace;
 
+extern int thing_grid_size;   // cell size of the thing grid, 0 for none
+
 #endif  // __P_MAPUTL__
 
 //----------------------------------------------------------------------------
@@ -44,6 +44,181 @@ rcsid[] = "$Id: p_mobj.c,v 1.27 1998/09/10 20:12:55 phares Exp $";
 #include "info.h"
 #include "g_game.h"
 
+//
+// Mobj handle table
+//
+// Slots freed by removed mobjs are reused last in, first out. The table
+// only grows, and is emptied at the start of each level.
+//
+
+typedef struct {
+  mobj_t   *mobj;         // NULL if the slot is free
+  unsigned generation;    // bumped each time the slot is handed out
+  int      nextfree;      // next free slot, or -1
+} mobjslot_t;
+
+static mobjslot_t *mobjslots;
+static int nummobjslots, mobjslots_alloc, freemobjslot = -1;
+
+// All MT_PLAYER things, voodoo dolls included, in no particular order.
+// Only these can have a player, so pushers look for things here (p_spec.c).
+// Kept with the handles, as a thing has one exactly as long as it exists.
+
+mobj_t **playerthings;
+int numplayerthings;
+static int playerthings_alloc;
+
+//
+// P_ClearMobjHandles
+// Frees every slot. Called when all mobjs are thrown away.
+//
+
+void P_ClearMobjHandles(void)
+  {
+  int i;
+
+  numplayerthings = 0;
+  freemobjslot = -1;
+  for (i = nummobjslots; --i >= 0; )       // lowest slots handed out first
+    {
+    mobjslots[i].mobj = NULL;
+    mobjslots[i].nextfree = freemobjslot;
+    freemobjslot = i;
+    }
+  }
+
+//
+// P_NewMobjHandle
+// Gives a mobj a slot and a handle of its own.
+//
+
+void P_NewMobjHandle(mobj_t *mobj)
+  {
+  int slot = freemobjslot;
+
+  if (slot >= 0)
+    freemobjslot = mobjslots[slot].nextfree;
+  else
+    {
+    if (nummobjslots >= MOBJ_MAXSLOTS)
+      I_Error("P_NewMobjHandle: More than %d things", MOBJ_MAXSLOTS);
+    if (nummobjslots >= mobjslots_alloc)
+      mobjslots = realloc(mobjslots, (mobjslots_alloc = mobjslots_alloc ?
+                          mobjslots_alloc*2 : 1024) * sizeof *mobjslots);
+    slot = nummobjslots++;
+    mobjslots[slot].generation = 0;
+    }
+
+  // generations run 1..MOBJ_GENMASK, so that no handle is ever 0
+
+  mobjslots[slot].generation = mobjslots[slot].generation % MOBJ_GENMASK + 1;
+  mobjslots[slot].mobj = mobj;
+  mobj->handle = (mobjhandle_t) mobjslots[slot].generation << MOBJ_SLOTBITS
+    | slot;
+
+  if (mobj->type == MT_PLAYER)
+    {
+    if (numplayerthings >= playerthings_alloc)
+      playerthings = realloc(playerthings, (playerthings_alloc =
+                             playerthings_alloc ? playerthings_alloc*2 : 8) *
+                             sizeof *playerthings);
+    playerthings[numplayerthings++] = mobj;
+    }
+  }
+
+//
+// P_FreeMobjHandle
+// Gives a removed mobj's slot back. Its handle no longer resolves.
+//
+
+static void P_FreeMobjHandle(mobj_t *mobj)
+  {
+  int slot = P_HandleSlot(mobj->handle);
+
+  if (slot < nummobjslots && mobjslots[slot].mobj == mobj)
+    {
+    mobjslots[slot].mobj = NULL;
+    mobjslots[slot].nextfree = freemobjslot;
+    freemobjslot = slot;
+    }
+
+  if (mobj->type == MT_PLAYER)
+    {
+    int i = numplayerthings;
+    while (--i >= 0 && playerthings[i] != mobj)
+      ;
+    if (i >= 0)
+      playerthings[i] = playerthings[--numplayerthings];
+    }
+  }
+
+//
+// P_MobjHandle
+// Returns the handle of a mobj, or 0 if it is NULL or has been removed.
+//
+
+mobjhandle_t P_MobjHandle(const mobj_t *mobj)
+  {
+  int slot;
+
+  if (!mobj)
+    return 0;
+
+  slot = P_HandleSlot(mobj->handle);
+  return slot < nummobjslots && mobjslots[slot].mobj == mobj ?
+    mobj->handle : 0;
+  }
+
+//
+// P_WakeMobj
+//
+// Puts a dormant mobj back on the run list. Anything which changes a mobj
+// from outside its own thinker (state, momentum, height) must call this
+// first, since a dormant mobj does not look at itself again until woken.
+//
+
+void P_WakeMobj(mobj_t *mobj)
+  {
+  if (mobj->thinker.aprev)
+    return;
+
+  if (mobj->target)
+    mobj->target->thinker.references--;
+
+  P_WakeThinker(&mobj->thinker);
+  }
+
+//
+// P_SleepMobj
+//
+// Makes a mobj dormant if nothing will happen to it until something else
+// disturbs it: an infinite-tic state, no momentum, resting on the floor
+// (or hanging from the ceiling), and not in a sector which is moving.
+//
+// A dormant mobj no longer runs the target check at the top of
+// P_MobjThinker, so it holds a reference on its target instead,
+// which keeps the target from being freed while it sleeps.
+//
+
+static void P_SleepMobj(mobj_t *mobj)
+  {
+  sector_t *sec = mobj->subsector->sector;
+
+  if (mobj->player || mobj->momx | mobj->momy | mobj->momz ||
+      mobj->flags & MF_SKULLFLY || sec->floordata || sec->ceilingdata)
+    return;
+
+  if (mobj->z != mobj->floorz &&
+      (!(mobj->flags & MF_NOGRAVITY) || mobj->flags & MF_FLOAT ||
+       mobj->z < mobj->floorz || mobj->z + mobj->height > mobj->ceilingz))
+    return;
+
+  if (mobj->target)
+    mobj->target->thinker.references++;
+
+  P_SleepThinker(&mobj->thinker);
+  }
+
 //
 // P_SetMobjState
 // Returns true if the mobj is still present.
@@ -62,6 +237,8 @@ boolean P_SetMobjState(mobj_t* mobj,statenum_t state)
   boolean ret = true;                         // return value
   statenum_t tempstate[NUMSTATES];            // for use with recursion
 
+  P_WakeMobj(mobj);
+
   if (recursion++)                            // if recursion detected,
     memset(seenstate=tempstate,0,sizeof tempstate); // clear state table
 
@@ -463,12 +640,36 @@ void P_NightmareRespawn(mobj_t* mobj)
   }
 
 
+//
+// P_SavePosition
+//
+// Keeps where a thing is at the start of a tic it moves in, for frames
+// drawn between tics. Players are seen to by P_PlayerThink, before they
+// turn.
+//
+
+void P_SavePosition (mobj_t* mobj)
+  {
+  if (mobj->prevtic != leveltime)
+    {
+    mobj->prevx = mobj->x;
+    mobj->prevy = mobj->y;
+    mobj->prevz = mobj->z;
+    mobj->prevangle = mobj->angle;
+    if (mobj->player)
+      mobj->prevviewz = mobj->player->viewz;
+    mobj->prevtic = leveltime;
+    }
+  }
+
 //
 // P_MobjThinker
 //
 
 void P_MobjThinker (mobj_t* mobj)
   {
+  P_SavePosition (mobj);
+
   // killough 4/25/98:
   //
   // If a mobj thinker's target points to a thinker about to be deleted,
@@ -511,13 +712,16 @@ void P_MobjThinker (mobj_t* mobj)
   else
     {
 
-    // check for nightmare respawn
+    // Unless it can respawn in nightmare, nothing more happens to
+    // this mobj until it is disturbed, so it can go dormant.
 
-    if (! (mobj->flags & MF_COUNTKILL) )
+    if (! (mobj->flags & MF_COUNTKILL) || !respawnmonsters)
+      {
+      P_SleepMobj(mobj);
       return;
+      }
 
-    if (!respawnmonsters)
-      return;
+    // check for nightmare respawn
 
     mobj->movecount++;
 
@@ -593,6 +797,8 @@ mobj_t* P_SpawnMobj(fixed_t x,fixed_t y,fixed_t z,mobjtype_t type)
   mobj->above_thing = 0;                                            // phares
   mobj->below_thing = 0;                                            // phares
   mobj->friction    = ORIG_FRICTION;                        // phares 3/17/98
+  mobj->prevtic     = -1;
+  P_NewMobjHandle (mobj);
   P_AddThinker (&mobj->thinker);
   return mobj;
   }
@@ -643,6 +849,8 @@ void P_RemoveMobj (mobj_t* mobj)
 
   // free block
 
+  P_FreeMobjHandle (mobj);
+  P_WakeMobj (mobj);
   P_RemoveThinker ((thinker_t*)mobj);
   }
 
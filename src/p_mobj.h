@@ -209,6 +209,23 @@ typedef enum
 } mobjflag_t;
 
 
+// Mobj handles.
+//
+// Each mobj has a slot in a handle table, and a handle made of the slot
+// number and a generation count which changes every time the slot is
+// reused. A handle therefore names one mobj for good: once the mobj has
+// been removed, P_MobjHandle gives 0 for it, so that a reference to it
+// is not taken for whatever has since been put in its place. Handle 0 is
+// never used.
+
+typedef unsigned long mobjhandle_t;
+
+#define MOBJ_SLOTBITS   20
+#define MOBJ_MAXSLOTS   (1<<MOBJ_SLOTBITS)
+#define MOBJ_GENMASK    ((1<<(32-MOBJ_SLOTBITS))-1)
+
+#define P_HandleSlot(h) ((int)((h) & (MOBJ_MAXSLOTS-1)))
+
 // Map Object definition.
 //
 // killough 2/20/98:
@@ -220,41 +237,59 @@ typedef enum
 // reason behind monsters going to sleep when loading savegames (the "target"
 // pointer was simply nullified after loading, to prevent Doom from crashing),
 // and the whole reason behind loadgames crashing on savegames of AV attacks.
-// 
+//
+// Savegames write each field explicitly (P_ArchiveThinkers), so the fields
+// may be reordered freely, but any new field which must survive a savegame
+// has to be added there and in P_UnArchiveThinkers as well.
+//
+// The fields are grouped by how often they are used. The ones read by the
+// blockmap, collision and sight checks for every nearby thing come first,
+// right after the thinker, so that those checks touch as few cache lines
+// of each mobj as possible. Rarely used fields go at the end. x, y and z
+// must stay first, since degenmobj_t (r_defs.h) is used as a mobj_t.
+//
 
 typedef struct mobj_s
 {
     // List: thinker links.
     thinker_t           thinker;
 
-    // Info for drawing: position.
+    // Position, size and flags, checked by PIT_CheckThing and friends.
     fixed_t             x;
     fixed_t             y;
     fixed_t             z;
-
-    // More list: links in sector (if needed)
-    struct mobj_s*      snext;
-    struct mobj_s*      sprev;
-
-    //More drawing info: to determine current sprite.
-    angle_t             angle;  // orientation
-    spritenum_t         sprite; // used to find patch_t and flip value
-    int                 frame;  // might be ORed with FF_FULLBRIGHT
+    fixed_t             radius;
+    fixed_t             height; 
+    int                 flags;
 
     // Interaction info, by BLOCKMAP.
     // Links in blocks (if needed).
     struct mobj_s*      bnext;
     struct mobj_s*      bprev;
-    
-    struct subsector_s* subsector;
+
+    // Place in the thing grid, see p_maputl.c. gridcell is -1 if the
+    // thing is not in it.
+    int                 gridcell;
+    int                 gridslot;
+
+    // Order of linking into its block, and the block+1 whose corpse list
+    // the thing is in, or 0 (see p_maputl.c).
+    unsigned            blockstamp;
+    int                 corpseblock;
+
+    // More list: links in sector (if needed)
+    struct mobj_s*      snext;
+    struct mobj_s*      sprev;
 
     // The closest interval over all contacted Sectors.
     fixed_t             floorz;
     fixed_t             ceilingz;
 
-    // For movement checking.
-    fixed_t             radius;
-    fixed_t             height; 
+    struct subsector_s* subsector;
+
+    mobjtype_t          type;
+    int                 health;
+    mobjinfo_t*         info;   // &mobjinfo[mobj->type]
 
     // Momentums, used to update position.
     fixed_t             momx;
@@ -264,13 +299,13 @@ typedef struct mobj_s
     // If == validcount, already checked.
     int                 validcount;
 
-    mobjtype_t          type;
-    mobjinfo_t*         info;   // &mobjinfo[mobj->type]
-    
     int                 tics;   // state tic counter
     state_t*            state;
-    int                 flags;
-    int                 health;
+
+    //More drawing info: to determine current sprite.
+    angle_t             angle;  // orientation
+    spritenum_t         sprite; // used to find patch_t and flip value
+    int                 frame;  // might be ORed with FF_FULLBRIGHT
 
     // Movement direction, movement generation (zig-zagging).
     int                 movedir;        // 0-7
@@ -292,18 +327,29 @@ typedef struct mobj_s
     // Only valid if type == MT_PLAYER
     struct player_s*    player;
 
-    // Player number last looked for.
-    int                 lastlook;       
-
-    // For nightmare respawn.
-    mapthing_t          spawnpoint;     
-
     // Thing being chased/attacked for tracers.
     struct mobj_s*      tracer; 
 
     // new field: last known enemy -- killough 2/15/98
     struct mobj_s*      lastenemy;
 
+    // Friction values for the sector the object is in
+    int friction;                                           // phares 3/17/98
+    int movefactor;
+
+    // a linked list of sectors where this object appears
+    struct msecnode_s* touching_sectorlist;                 // phares 3/14/98
+
+    // A box around the thing with no lines in it, within which it can move
+    // without touching_sectorlist changing. See P_CreateSecNodeList.
+    fixed_t             secnodebox[4];
+
+    // Player number last looked for.
+    int                 lastlook;       
+
+    // For nightmare respawn.
+    mapthing_t          spawnpoint;     
+
     // Are we above a Thing? above_thing points to the Thing        // phares
     // if so, otherwise it's zero.                                  //   |
                                                                     //   V
@@ -314,12 +360,18 @@ typedef struct mobj_s
                                                                     //   ^
     struct mobj_s* below_thing;                                     //   |
                                                                     // phares
-    // Friction values for the sector the object is in
-    int friction;                                           // phares 3/17/98
-    int movefactor;
-
-    // a linked list of sectors where this object appears
-    struct msecnode_s* touching_sectorlist;                 // phares 3/14/98
+    // This mobj's handle (see above)
+    mobjhandle_t        handle;
+
+    // Where the thing was at the start of tic prevtic, the last it moved
+    // in, for frames drawn between tics (see r_main.c). prevtic is -1
+    // after a jump, such as a teleport, which is not to be smoothed over.
+    fixed_t             prevx;
+    fixed_t             prevy;
+    fixed_t             prevz;
+    angle_t             prevangle;
+    fixed_t             prevviewz;   // and its player's viewz, if any
+    int                 prevtic;
 
     // SEE WARNING ABOVE ABOUT POINTER FIELDS!!!
 
@@ -347,11 +399,19 @@ extern int itemrespawntime[];
 extern int iquehead;
 extern int iquetail;
 
+extern mobj_t **playerthings;     // all MT_PLAYER things
+extern int numplayerthings;
+
 void    P_RespawnSpecials(void);
 mobj_t  *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type);
 void    P_RemoveMobj(mobj_t *th);
 boolean P_SetMobjState(mobj_t *mobj, statenum_t state);
 void    P_MobjThinker(mobj_t *mobj);
+void    P_SavePosition(mobj_t *mobj);
+void    P_WakeMobj(mobj_t *mobj);
+void    P_ClearMobjHandles(void);
+void    P_NewMobjHandle(mobj_t *mobj);
+mobjhandle_t P_MobjHandle(const mobj_t *mobj);
 void    P_SpawnPuff(fixed_t x, fixed_t y, fixed_t z);
 void    P_SpawnBlood(fixed_t x, fixed_t y, fixed_t z, int damage);
 mobj_t  *P_SpawnMissile(mobj_t *source, mobj_t *dest, mobjtype_t type);
@@ -35,6 +35,7 @@ rcsid[] = "$Id: p_saveg.c,v 1.19 1998/09/16 06:59:39 phares Exp $";
 #include "p_maputl.h"
 #include "p_spec.h"
 #include "p_tick.h"
+#include "p_setup.h"
 #include "p_saveg.h"
 #include "m_random.h"
 #include "am_map.h"
@@ -45,6 +46,20 @@ byte *save_p;
 // Pads save_p to a 4-byte boundary
 //  so that the load/save works on SGI&Gecko.
 #define PADSAVEP()    do { save_p += (4 - ((int) save_p & 3)) & 3; } while (0)
+
+// killough 2/14/98: convert pointers into indices.
+// Fixes many savegame problems, by properly saving
+// target and tracer fields. Note: we store NULL if
+// the mobj pointed to by these fields has been removed.
+//
+// The index saved is the mobj's handle table slot plus one, so that
+// 0 stands for NULL. See P_UnArchiveThinkers for the reverse.
+
+static long P_MobjToIndex(const mobj_t *mobj)
+{
+  mobjhandle_t handle = P_MobjHandle(mobj);
+  return handle ? P_HandleSlot(handle) + 1 : 0;
+}
 //
 // P_ArchivePlayers
 //
@@ -101,96 +116,148 @@ void P_UnArchivePlayers (void)
 
 
 //
-// P_ArchiveWorld
+// The world is saved as the sectors and lines which differ from how they
+// were when the level was set up, which is usually few of them: a load
+// sets up the level before reading the world back, so the rest are left
+// as they were. P_MarkWorld keeps the saved form of every sector and line
+// as of the setup, for P_ArchiveWorld to compare against.
 //
-void P_ArchiveWorld (void)
+
+#define SECTORSAVESIZE 8      // shorts, including the soundtarget
+#define LINESAVESIZE  13      // shorts, 5 per side (0 if there is none)
+
+static short *worldbase;      // PU_LEVEL, so freed with the level
+
+static short *P_PutSector(short *put, const sector_t *sec)
 {
-  int            i;
-  const sector_t *sec;
-  const line_t   *li;
-  short          *put;
+  *put++ = sec->floorheight >> FRACBITS;
+  *put++ = sec->ceilingheight >> FRACBITS;
+  *put++ = sec->floorpic;
+  *put++ = sec->ceilingpic;
+  *put++ = sec->lightlevel;
+  *put++ = sec->special;            // needed?   yes -- transfer types
+  *put++ = sec->tag;                // needed?   need them -- killough
+
+  // phares 9/13/98: Save the index of the thinker, so that sound
+  // traces can survive savegames.
+
+  *put++ = P_MobjToIndex(sec->soundtarget);   // 0 if no soundtarget
+  return put;
+}
 
-  // killough 3/22/98: fix bug caused by hoisting save_p too early
+static short *P_PutLine(short *put, const line_t *li)
+{
+  int j;
+
+  *put++ = li->flags;
+  *put++ = li->special;
+  *put++ = li->tag;
+
+  for (j=0; j<2; j++)
+    if (li->sidenum[j] != -1)
+      {
+        const side_t *si = &sides[li->sidenum[j]];
+        *put++ = si->textureoffset >> FRACBITS;
+        *put++ = si->rowoffset >> FRACBITS;
+        *put++ = si->toptexture;
+        *put++ = si->bottomtexture;
+        *put++ = si->midtexture;
+      }
+    else
+      {
+        memset(put, 0, sizeof(short)*5);
+        put += 5;
+      }
+  return put;
+}
 
-  size_t size = (sizeof(short)*7)*numsectors + (sizeof(short)*3)*numlines + 4;
+//
+// P_MarkWorld
+//
+// Called at the end of P_SetupLevel.
+//
 
+void P_MarkWorld(void)
+{
+  short *put;
+  int   i;
+
+  put = worldbase = Z_Malloc(sizeof(short) * (numsectors*SECTORSAVESIZE +
+                                              numlines*LINESAVESIZE),
+                             PU_LEVEL, NULL);
+  for (i=0; i<numsectors; i++)
+    put = P_PutSector(put, &sectors[i]);
   for (i=0; i<numlines; i++)
-    {
-      if (lines[i].sidenum[0] != -1)
-        size += sizeof(short)*5;
-      if (lines[i].sidenum[1] != -1)
-        size += sizeof(short)*5;
-    }
+    put = P_PutLine(put, &lines[i]);
+}
+
+//
+// P_ArchiveWorld
+//
+// Each changed sector or line is saved as its index plus one, followed
+// by its saved form; a 0 ends each list.
+//
+
+void P_ArchiveWorld (void)
+{
+  int         i;
+  const short *base = worldbase;
+  short       *put;
+
+  // killough 3/22/98: fix bug caused by hoisting save_p too early
 
-  CheckSaveGame(size); // killough
+  CheckSaveGame(sizeof(short) * (numsectors*(SECTORSAVESIZE+1) +
+                                 numlines*(LINESAVESIZE+1) + 2) + 4);
 
   PADSAVEP();                // killough 3/22/98
 
   put = (short *)save_p;
 
   // do sectors
-  for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+  for (i=0; i<numsectors; i++, base += SECTORSAVESIZE)
     {
-      *put++ = sec->floorheight >> FRACBITS;
-      *put++ = sec->ceilingheight >> FRACBITS;
-      *put++ = sec->floorpic;
-      *put++ = sec->ceilingpic;
-      *put++ = sec->lightlevel;
-      *put++ = sec->special;            // needed?   yes -- transfer types
-      *put++ = sec->tag;                // needed?   need them -- killough
-
-      // phares 9/13/98: Save the index of the thinker, so that sound
-      // traces can survive savegames. The prev pointer in the thinker
-      // list has been mapped to an index in P_ThinkerToIndex().
-
-      if (sec->soundtarget)
-        *put++ = (long) sec->soundtarget->thinker.prev;
-      else
-        *put++ = 0; // no soundtarget
+      *put = i+1;
+      if (memcmp(P_PutSector(put+1, &sectors[i]) - SECTORSAVESIZE, base,
+                 sizeof(short)*SECTORSAVESIZE))
+        put += 1+SECTORSAVESIZE;
     }
+  *put++ = 0;
 
   // do lines
-  for (i=0, li = lines ; i<numlines ; i++,li++)
+  for (i=0; i<numlines; i++, base += LINESAVESIZE)
     {
-      int j;
-
-      *put++ = li->flags;
-      *put++ = li->special;
-      *put++ = li->tag;
-
-      for (j=0; j<2; j++)
-        if (li->sidenum[j] != -1)
-          {
-            const side_t *si = &sides[li->sidenum[j]];
-            *put++ = si->textureoffset >> FRACBITS;
-            *put++ = si->rowoffset >> FRACBITS;
-            *put++ = si->toptexture;
-            *put++ = si->bottomtexture;
-            *put++ = si->midtexture;
-          }
+      *put = i+1;
+      if (memcmp(P_PutLine(put+1, &lines[i]) - LINESAVESIZE, base,
+                 sizeof(short)*LINESAVESIZE))
+        put += 1+LINESAVESIZE;
     }
+  *put++ = 0;
+
   save_p = (byte *) put;
 }
 
-
-
 //
 // P_UnArchiveWorld
 //
+
 void P_UnArchiveWorld (void)
 {
   int          i;
   sector_t     *sec;
-  line_t       *li;
   const short  *get;
 
+  // jff 2/22/98 now three thinker fields, not two
+  for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+    sec->ceilingdata = sec->floordata = sec->lightingdata = 0;
+
   PADSAVEP();                // killough 3/22/98
 
   get = (short *) save_p;
 
   // do sectors
-  for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+  while ((i = (unsigned short) *get++))
     {
+      sec = &sectors[i-1];
       sec->floorheight = *get++ << FRACBITS;
       sec->ceilingheight = *get++ << FRACBITS;
       sec->floorpic = *get++;
@@ -198,9 +265,6 @@ void P_UnArchiveWorld (void)
       sec->lightlevel = *get++;
       sec->special = *get++;
       sec->tag = *get++;
-      sec->ceilingdata = 0; //jff 2/22/98 now three thinker fields, not two
-      sec->floordata = 0;
-      sec->lightingdata = 0;
 
       // phares 9/13/98: soundtarget has meaning, to save sound info across
       // savegames.
@@ -213,22 +277,23 @@ void P_UnArchiveWorld (void)
     }
 
   // do lines
-  for (i=0, li = lines ; i<numlines ; i++,li++)
+  while ((i = (unsigned short) *get++))
     {
+      line_t *li = &lines[i-1];
       int j;
 
       li->flags = *get++;
       li->special = *get++;
       li->tag = *get++;
-      for (j=0 ; j<2 ; j++)
+      for (j=0 ; j<2 ; j++, get += 5)
         if (li->sidenum[j] != -1)
           {
             side_t *si = &sides[li->sidenum[j]];
-            si->textureoffset = *get++ << FRACBITS;
-            si->rowoffset = *get++ << FRACBITS;
-            si->toptexture = *get++;
-            si->bottomtexture = *get++;
-            si->midtexture = *get++;
+            si->textureoffset = get[0] << FRACBITS;
+            si->rowoffset = get[1] << FRACBITS;
+            si->toptexture = get[2];
+            si->bottomtexture = get[3];
+            si->midtexture = get[4];
           }
     }
   save_p = (byte *) get;
@@ -243,37 +308,17 @@ typedef enum {
   tc_mobj
 } thinkerclass_t;
 
-// phares 9/13/98: Moved this code outside of P_ArchiveThinkers so the
-// thinker indices could be used by the code that saves sector info.
-
-static int number_of_thinkers;
-
-void P_ThinkerToIndex(void)
-  {
-  thinker_t *th;
-
-  // killough 2/14/98:
-  // count the number of thinkers, and mark each one with its index, using
-  // the prev field as a placeholder, since it can be restored later.
-
-  number_of_thinkers = 0;
-  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-    if (th->function.acp1 == (actionf_p1) P_MobjThinker)
-      th->prev = (thinker_t *) ++number_of_thinkers;
-  }
-
-// phares 9/13/98: Moved this code outside of P_ArchiveThinkers so the
-// thinker indices could be used by the code that saves sector info.
-
-void P_IndexToThinker(void)
-  {
-  // killough 2/14/98: restore prev pointers
-  thinker_t *th;
-  thinker_t *prev = &thinkercap;
+//
+// Mobjs are saved field by field, rather than by copying mobj_t, so that
+// the layout of mobj_t in memory is free to change. Each saved mobj is a
+// fixed number of longs, in the order below, starting with its own index;
+// the links and caches which P_SetThingPosition and P_AddThinker rebuild
+// are not saved, except for the order of the sector and blockmap chains.
+// Things are found in chain order by the map iterators, so the order must
+// survive a load for a game (or a demo rewound from memory) to stay in sync.
+//
 
-  for (th = thinkercap.next ; th != &thinkercap ; prev=th, th=th->next)
-    th->prev = prev;
-  }
+#define MOBJSAVESIZE (39*sizeof(long))
 
 //
 // P_ArchiveThinkers
@@ -288,62 +333,70 @@ void P_ArchiveThinkers (void)
   memcpy(save_p, &brain, sizeof brain);
   save_p += sizeof brain;
 
-  // check that enough room is available in savegame buffer
-  CheckSaveGame(number_of_thinkers*(sizeof(mobj_t)+4));       // killough 2/14/98
-
   // save off the current thinkers
-  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-    if (th->function.acp1 == (actionf_p1) P_MobjThinker)
-      {
-        mobj_t *mobj;
+  for (th = mobjthinkercap.mnext;
+       th != &mobjthinkercap; th=th->mnext)
+    {
+      const mobj_t *mobj = (mobj_t *) th;
+      long *put;
 
-        *save_p++ = tc_mobj;
-        PADSAVEP();
-        mobj = (mobj_t *)save_p;
-        memcpy (mobj, th, sizeof(*mobj));
-        save_p += sizeof(*mobj);
-        mobj->state = (state_t *)(mobj->state - states);
-
-        // killough 2/14/98: convert pointers into indices.
-        // Fixes many savegame problems, by properly saving
-        // target and tracer fields. Note: we store NULL if
-        // the thinker pointed to by these fields is not a
-        // mobj thinker.
-
-        if (mobj->target)
-          mobj->target = mobj->target->thinker.function.acp1 ==
-            (actionf_p1) P_MobjThinker ?
-            (mobj_t *) mobj->target->thinker.prev : NULL;
-
-        if (mobj->tracer)
-          mobj->tracer = mobj->tracer->thinker.function.acp1 ==
-            (actionf_p1) P_MobjThinker ?
-            (mobj_t *) mobj->tracer->thinker.prev : NULL;
-
-        // killough 2/14/98: new field: save last known enemy. Prevents
-        // monsters from going to sleep after killing monsters and not
-        // seeing player anymore.
-
-        if (mobj->lastenemy)
-          mobj->lastenemy = mobj->lastenemy->thinker.function.acp1 ==
-            (actionf_p1) P_MobjThinker ?
-            (mobj_t *) mobj->lastenemy->thinker.prev : NULL;
-
-        // killough 2/14/98: end changes
-
-        if (mobj->above_thing)                                      // phares
-          mobj->above_thing = mobj->above_thing->thinker.function.acp1 ==
-            (actionf_p1) P_MobjThinker ?
-            (mobj_t *) mobj->above_thing->thinker.prev : NULL;
-
-        if (mobj->below_thing)
-          mobj->below_thing = mobj->below_thing->thinker.function.acp1 ==
-            (actionf_p1) P_MobjThinker ?
-            (mobj_t *) mobj->below_thing->thinker.prev : NULL;      // phares
-
-        if (mobj->player)
-          mobj->player = (player_t *)((mobj->player-players) + 1);
-      }
+      // check that enough room is available in savegame buffer
+      CheckSaveGame(MOBJSAVESIZE+4);                          // killough 2/14/98
+
+      *save_p++ = tc_mobj;
+      PADSAVEP();
+      put = (long *) save_p;
+
+      *put++ = P_MobjToIndex(mobj);
+      *put++ = mobj->x;
+      *put++ = mobj->y;
+      *put++ = mobj->z;
+      *put++ = mobj->angle;
+      *put++ = mobj->sprite;
+      *put++ = mobj->frame;
+      *put++ = mobj->floorz;
+      *put++ = mobj->ceilingz;
+      *put++ = mobj->radius;
+      *put++ = mobj->height;
+      *put++ = mobj->momx;
+      *put++ = mobj->momy;
+      *put++ = mobj->momz;
+      *put++ = mobj->type;
+      *put++ = mobj->tics;
+      *put++ = mobj->state - states;
+      *put++ = mobj->flags;
+      *put++ = mobj->health;
+      *put++ = mobj->movedir;
+      *put++ = mobj->movecount;
+      *put++ = P_MobjToIndex(mobj->target);
+      *put++ = mobj->reactiontime;
+      *put++ = mobj->threshold;
+      *put++ = mobj->player ? mobj->player - players + 1 : 0;
+      *put++ = mobj->lastlook;
+      *put++ = mobj->spawnpoint.x;
+      *put++ = mobj->spawnpoint.y;
+      *put++ = mobj->spawnpoint.angle;
+      *put++ = mobj->spawnpoint.type;
+      *put++ = mobj->spawnpoint.options;
+      *put++ = P_MobjToIndex(mobj->tracer);
+
+      // killough 2/14/98: new field: save last known enemy. Prevents
+      // monsters from going to sleep after killing monsters and not
+      // seeing player anymore.
+
+      *put++ = P_MobjToIndex(mobj->lastenemy);
+      *put++ = P_MobjToIndex(mobj->above_thing);                  // phares
+      *put++ = P_MobjToIndex(mobj->below_thing);
+      *put++ = mobj->friction;
+      *put++ = mobj->movefactor;
+      *put++ = mobj->flags & MF_NOSECTOR ? 0 : P_MobjToIndex(mobj->snext);
+      *put++ = mobj->flags & MF_NOBLOCKMAP ? 0 : P_MobjToIndex(mobj->bnext);
+
+      if ((byte *) put - save_p != MOBJSAVESIZE)
+        I_Error("P_ArchiveThinkers: mobj saved in %d bytes, not %d",
+                (int) ((byte *) put - save_p), (int) MOBJSAVESIZE);
+      save_p = (byte *) put;
+    }
 
   // add a terminating marker
   *save_p++ = tc_end;
@@ -359,6 +412,7 @@ void P_UnArchiveThinkers (void)
 {
   thinker_t *th;
   mobj_t    **mobj_p;    // killough 2/14/98: Translation table
+  size_t    *links;      // saved sector and blockmap chain links, by index
   size_t    size;        // killough 2/14/98: size of or index into table
   int       i;           // phares 9/13/98:   For sec->soundtarget restore
   sector_t* sec;         // phares 9/13/98:   For sec->soundtarget restore
@@ -378,42 +432,94 @@ void P_UnArchiveThinkers (void)
       th = next;
     }
   P_InitThinkers ();
+  P_ClearMobjHandles ();
 
-  // killough 2/14/98: count number of thinkers by skipping through them
+  // killough 2/14/98: find the size of the index table by skipping
+  // through the thinkers. Indices are handle slots, so may have gaps.
   {
     byte *sp = save_p;     // save pointer and skip header
-    for (size = 1; *save_p++ == tc_mobj; size++)  // killough 2/14/98
-      {                     // skip all entries, adding up count
+    for (size = 1; *save_p++ == tc_mobj; )    // killough 2/14/98
+      {                     // skip all entries, finding the largest index
         PADSAVEP();
-        save_p += sizeof(mobj_t);
+        if ((size_t) *(long *) save_p >= size)
+          size = *(long *) save_p + 1;
+        save_p += MOBJSAVESIZE;
       }
 
     if (*--save_p != tc_end)
       I_Error ("Unknown tclass %i in savegame", *save_p);
 
-    // first table entry special: 0 maps to NULL
-    *(mobj_p = malloc(size * sizeof *mobj_p)) = 0;   // table of pointers
+    // first table entry special: 0 maps to NULL, as do any gaps
+    mobj_p = calloc(size, sizeof *mobj_p);   // table of pointers
+    links = calloc(size, 2 * sizeof *links);
     save_p = sp;           // restore save pointer
   }
 
   // read in saved thinkers
-  for (size = 1; *save_p++ == tc_mobj; size++)    // killough 2/14/98
+  while (*save_p++ == tc_mobj)    // killough 2/14/98
     {
       mobj_t *mobj = Z_Malloc(sizeof(mobj_t), PU_LEVEL, NULL);
-
-      // killough 2/14/98 -- insert pointers to thinkers into table, in order:
-      mobj_p[size] = mobj;
+      const long *get;
+      size_t index;
 
       PADSAVEP();
-      memcpy (mobj, save_p, sizeof(mobj_t));
-      save_p += sizeof(mobj_t);
-      mobj->state = states + (int) mobj->state;
+      get = (const long *) save_p;
+      memset(mobj, 0, sizeof *mobj);
+
+      // killough 2/14/98 -- insert pointers to thinkers into table:
+      mobj_p[index = *get++] = mobj;
+
+      // Pointers to other mobjs are read as indices, and are
+      // converted below, once all the mobjs have been read.
+
+      mobj->x = *get++;
+      mobj->y = *get++;
+      mobj->z = *get++;
+      mobj->angle = *get++;
+      mobj->sprite = *get++;
+      mobj->frame = *get++;
+      mobj->floorz = *get++;
+      mobj->ceilingz = *get++;
+      mobj->radius = *get++;
+      mobj->height = *get++;
+      mobj->momx = *get++;
+      mobj->momy = *get++;
+      mobj->momz = *get++;
+      mobj->type = *get++;
+      mobj->tics = *get++;
+      mobj->state = states + *get++;
+      mobj->flags = *get++;
+      mobj->health = *get++;
+      mobj->movedir = *get++;
+      mobj->movecount = *get++;
+      mobj->target = (mobj_t *) *get++;
+      mobj->reactiontime = *get++;
+      mobj->threshold = *get++;
+      if ((i = *get++))
+        (mobj->player = &players[i - 1]) -> mo = mobj;
+      mobj->lastlook = *get++;
+      mobj->spawnpoint.x = *get++;
+      mobj->spawnpoint.y = *get++;
+      mobj->spawnpoint.angle = *get++;
+      mobj->spawnpoint.type = *get++;
+      mobj->spawnpoint.options = *get++;
+      mobj->tracer = (mobj_t *) *get++;
+      mobj->lastenemy = (mobj_t *) *get++;
+      mobj->above_thing = (mobj_t *) *get++;
+      mobj->below_thing = (mobj_t *) *get++;
+      mobj->friction = *get++;
+      mobj->movefactor = *get++;
+      links[index*2] = *get++;        // the snext and bnext chain links
+      links[index*2+1] = *get++;
+
+      if ((byte *) get - save_p != MOBJSAVESIZE)   // must match the above
+        I_Error("P_UnArchiveThinkers: mobj read in %d bytes, not %d",
+                (int) ((byte *) get - save_p), (int) MOBJSAVESIZE);
+      save_p = (byte *) get;
 
-      if (mobj->player)
-        (mobj->player = &players[(int) mobj->player - 1]) -> mo = mobj;
-
-      P_SetThingPosition (mobj);
       mobj->info = &mobjinfo[mobj->type];
+      mobj->prevtic = -1;
+      P_SetThingPosition (mobj);    // the chains are redone below
 
       // killough 2/28/98:
       // Fix for falling down into a wall after savegame loaded:
@@ -421,6 +527,7 @@ void P_UnArchiveThinkers (void)
       //      mobj->ceilingz = mobj->subsector->sector->ceilingheight;
 
       mobj->thinker.function.acp1 = (actionf_p1) P_MobjThinker;
+      P_NewMobjHandle (mobj);
       P_AddThinker (&mobj->thinker);
     }
 
@@ -448,11 +555,55 @@ void P_UnArchiveThinkers (void)
         mobj_p[(size_t)((mobj_t *)th)->below_thing];
     }
 
+  // The saved chain links are kept aside until now, rather than in the
+  // mobjs, since P_SetThingPosition links each mobj to the one before.
+
+  for (i = 1; i < (int) size; i++)
+    if (mobj_p[i])
+      {
+        mobj_t *mobj = mobj_p[i];
+        mobj->snext = mobj_p[links[i*2]];
+        mobj->bnext = mobj_p[links[i*2+1]];
+        mobj->sprev = mobj->bprev = NULL;
+      }
+  free(links);
+
+  // Relink the sector and blockmap chains in their saved order. Every
+  // thing in a chain was saved, so the head of each chain is the one
+  // thing which no other thing links to.
+
+  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+      mobj_t *mobj = (mobj_t *) th;
+      if (!(mobj->flags & MF_NOSECTOR) && mobj->snext)
+        mobj->snext->sprev = mobj;
+      if (!(mobj->flags & MF_NOBLOCKMAP) && mobj->bnext)
+        mobj->bnext->bprev = mobj;
+    }
+
+  for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+      mobj_t *mobj = (mobj_t *) th;
+      if (!(mobj->flags & MF_NOSECTOR) && !mobj->sprev)
+        mobj->subsector->sector->thinglist = mobj;
+      if (!(mobj->flags & MF_NOBLOCKMAP) && !mobj->bprev)
+        {
+          int blockx = (mobj->x - bmaporgx)>>MAPBLOCKSHIFT;
+          int blocky = (mobj->y - bmaporgy)>>MAPBLOCKSHIFT;
+          if (blockx>=0 && blockx < bmapwidth &&
+              blocky>=0 && blocky < bmapheight)
+            blocklinks[blocky*bmapwidth+blockx] = mobj;
+        }
+    }
+
+  P_RestampBlockChains();
+
   // phares 9/13/98: Restore sec->soundtarget pointers from indices.
   // NULL entries automatically handled by first table entry.
 
   for (i = 0, sec = sectors ; i < numsectors ; i++, sec++)
-    sec->soundtarget = mobj_p[(size_t) sec->soundtarget];
+    sec->soundtarget = (size_t) sec->soundtarget < size ?
+      mobj_p[(size_t) sec->soundtarget] : NULL;     // index saved as short
 
   free(mobj_p);    // free translation table
 
@@ -477,6 +628,7 @@ enum {
   tc_scroll,      // killough 3/7/98: new scroll effect thinker
   tc_friction,    // phares 3/18/98:  new friction effect thinker
   tc_pusher,      // phares 3/22/98:  new push/pull effect thinker
+  tc_position,    // number of mobjs before the specials which follow
   tc_endspecials
 } specials_e;
 
@@ -495,11 +647,49 @@ enum {
 // T_Friction                                               // phares 3/18/98
 // T_Pusher                                                 // phares 3/22/98
 //
+// The specials are saved after the mobjs, but run interleaved with them,
+// in the order in which they were added. A tc_position entry records how
+// many mobjs come before the specials which follow it, so that loading
+// can put them back in their places in the thinker list.
+//
+
+//
+// Specials are saved without their thinker_t, which holds the links and
+// the action, all rebuilt on load, except that a ceiling or plat in
+// stasis has no action: so a byte saying whether there is one comes
+// first. P_SaveSpecial returns where the copy would start if thinker_t
+// had been saved too, for the caller to swizzle its pointers in place.
+//
+
+static void *P_SaveSpecial(int tclass, const thinker_t *th, size_t size)
+{
+  byte *body;
+
+  *save_p++ = tclass;
+  *save_p++ = th->function.acv != NULL;
+  PADSAVEP();
+  memcpy(body = save_p, th + 1, size -= sizeof *th);
+  save_p += size;
+  return body - sizeof *th;
+}
+
+static void *P_LoadSpecial(size_t size, actionf_p1 action)
+{
+  thinker_t *th = Z_Malloc(size, PU_LEVEL, NULL);
+
+  memset(th, 0, sizeof *th);
+  th->function.acp1 = *save_p++ ? action : NULL;
+  PADSAVEP();
+  memcpy(th + 1, save_p, size -= sizeof *th);
+  save_p += size;
+  return th;
+}
 
 void P_ArchiveSpecials (void)
 {
   thinker_t *th;
   size_t    size = 0;          // killough
+  long      mobjs = 0, placed = 0;
 
   // save off the current thinkers (memory size calculation -- killough)
 
@@ -544,6 +734,22 @@ void P_ArchiveSpecials (void)
   // save off the current thinkers
   for (th=thinkercap.next; th!=&thinkercap; th=th->next)
     {
+      if (th->function.acp1 == (actionf_p1) P_MobjThinker)
+        {
+          mobjs++;
+          continue;
+        }
+
+      if (mobjs != placed)
+        {
+          CheckSaveGame(4+sizeof mobjs);
+          *save_p++ = tc_position;
+          PADSAVEP();
+          memcpy(save_p, &mobjs, sizeof mobjs);
+          save_p += sizeof mobjs;
+          placed = mobjs;
+        }
+
       if (th->function.acv == (actionf_v)NULL)
         {
           platlist_t *pl;
@@ -569,23 +775,14 @@ void P_ArchiveSpecials (void)
         {
           ceiling_t *ceiling;
         ceiling:                               // killough 2/14/98
-          *save_p++ = tc_ceiling;
-          PADSAVEP();
-          ceiling = (ceiling_t *)save_p;
-          memcpy (ceiling, th, sizeof(*ceiling));
-          save_p += sizeof(*ceiling);
+          ceiling = P_SaveSpecial(tc_ceiling, th, sizeof *ceiling);
           ceiling->sector = (sector_t *)(ceiling->sector - sectors);
           continue;
         }
 
       if (th->function.acp1 == (actionf_p1) T_VerticalDoor)
         {
-          vldoor_t *door;
-          *save_p++ = tc_door;
-          PADSAVEP();
-          door = (vldoor_t *) save_p;
-          memcpy (door, th, sizeof *door);
-          save_p += sizeof(*door);
+          vldoor_t *door = P_SaveSpecial(tc_door, th, sizeof *door);
           door->sector = (sector_t *)(door->sector - sectors);
           //jff 1/31/98 archive line remembered by door as well
           door->line = (line_t *) (door->line ? door->line-lines : -1);
@@ -594,12 +791,7 @@ void P_ArchiveSpecials (void)
 
       if (th->function.acp1 == (actionf_p1) T_MoveFloor)
         {
-          floormove_t *floor;
-          *save_p++ = tc_floor;
-          PADSAVEP();
-          floor = (floormove_t *)save_p;
-          memcpy (floor, th, sizeof(*floor));
-          save_p += sizeof(*floor);
+          floormove_t *floor = P_SaveSpecial(tc_floor, th, sizeof *floor);
           floor->sector = (sector_t *)(floor->sector - sectors);
           continue;
         }
@@ -608,35 +800,21 @@ void P_ArchiveSpecials (void)
         {
           plat_t *plat;
         plat:   // killough 2/14/98: added fix for original plat height above
-          *save_p++ = tc_plat;
-          PADSAVEP();
-          plat = (plat_t *)save_p;
-          memcpy (plat, th, sizeof(*plat));
-          save_p += sizeof(*plat);
+          plat = P_SaveSpecial(tc_plat, th, sizeof *plat);
           plat->sector = (sector_t *)(plat->sector - sectors);
           continue;
         }
 
       if (th->function.acp1 == (actionf_p1) T_LightFlash)
         {
-          lightflash_t *flash;
-          *save_p++ = tc_flash;
-          PADSAVEP();
-          flash = (lightflash_t *)save_p;
-          memcpy (flash, th, sizeof(*flash));
-          save_p += sizeof(*flash);
+          lightflash_t *flash = P_SaveSpecial(tc_flash, th, sizeof *flash);
           flash->sector = (sector_t *)(flash->sector - sectors);
           continue;
         }
 
       if (th->function.acp1 == (actionf_p1) T_StrobeFlash)
         {
-          strobe_t *strobe;
-          *save_p++ = tc_strobe;
-          PADSAVEP();
-          strobe = (strobe_t *)save_p;
-          memcpy (strobe, th, sizeof(*strobe));
-          save_p += sizeof(*strobe);
+          strobe_t *strobe = P_SaveSpecial(tc_strobe, th, sizeof *strobe);
           strobe->sector = (sector_t *)(strobe->sector - sectors);
           continue;
         }
@@ -644,24 +822,15 @@ void P_ArchiveSpecials (void)
       //jff 8/8/98 add missing fire flicker special
       if (th->function.acp1 == (actionf_p1) T_FireFlicker)
         {
-          fireflicker_t *flick;
-          *save_p++ = tc_flicker;
-          PADSAVEP();
-          flick = (fireflicker_t *)save_p;
-          memcpy (flick, th, sizeof(*flick));
-          save_p += sizeof(*flick);
+          fireflicker_t *flick =
+            P_SaveSpecial(tc_flicker, th, sizeof *flick);
           flick->sector = (sector_t *)(flick->sector - sectors);
           continue;
         }
 
       if (th->function.acp1 == (actionf_p1) T_Glow)
         {
-          glow_t *glow;
-          *save_p++ = tc_glow;
-          PADSAVEP();
-          glow = (glow_t *)save_p;
-          memcpy (glow, th, sizeof(*glow));
-          save_p += sizeof(*glow);
+          glow_t *glow = P_SaveSpecial(tc_glow, th, sizeof *glow);
           glow->sector = (sector_t *)(glow->sector - sectors);
           continue;
         }
@@ -669,12 +838,8 @@ void P_ArchiveSpecials (void)
       //jff 2/22/98 new case for elevators
       if (th->function.acp1 == (actionf_p1) T_MoveElevator)
         {
-          elevator_t *elevator;         //jff 2/22/98
-          *save_p++ = tc_elevator;
-          PADSAVEP();
-          elevator = (elevator_t *)save_p;
-          memcpy (elevator, th, sizeof(*elevator));
-          save_p += sizeof(*elevator);
+          elevator_t *elevator =           //jff 2/22/98
+            P_SaveSpecial(tc_elevator, th, sizeof *elevator);
           elevator->sector = (sector_t *)(elevator->sector - sectors);
           continue;
         }
@@ -682,9 +847,7 @@ void P_ArchiveSpecials (void)
       // killough 3/7/98: Scroll effect thinkers
       if (th->function.acp1 == (actionf_p1) T_Scroll)
         {
-          *save_p++ = tc_scroll;
-          memcpy (save_p, th, sizeof(scroll_t));
-          save_p += sizeof(scroll_t);
+          P_SaveSpecial(tc_scroll, th, sizeof(scroll_t));
           continue;
         }
 
@@ -692,9 +855,7 @@ void P_ArchiveSpecials (void)
 
       if (th->function.acp1 == (actionf_p1) T_Friction)
         {
-          *save_p++ = tc_friction;
-          memcpy (save_p, th, sizeof(friction_t));
-          save_p += sizeof(friction_t);
+          P_SaveSpecial(tc_friction, th, sizeof(friction_t));
           continue;
         }
 
@@ -702,9 +863,7 @@ void P_ArchiveSpecials (void)
 
       if (th->function.acp1 == (actionf_p1) T_Pusher)
         {
-          *save_p++ = tc_pusher;
-          memcpy (save_p, th, sizeof(pusher_t));
-          save_p += sizeof(pusher_t);
+          P_SaveSpecial(tc_pusher, th, sizeof(pusher_t));
           continue;
         }
     }
@@ -714,6 +873,23 @@ void P_ArchiveSpecials (void)
 }
 
 
+//
+// P_AddSpecial
+//
+// Adds a loaded special to the thinker list, just after the last special
+// loaded or the mobj given by the last tc_position entry. The mobjs are
+// all loaded by now, in order, on the mobj list.
+//
+
+static thinker_t *special_after;
+
+static void P_AddSpecial(thinker_t *thinker)
+{
+  P_AddThinker(thinker);
+  P_MoveThinker(thinker, special_after);
+  special_after = thinker;
+}
+
 //
 // P_UnArchiveSpecials
 //
@@ -721,166 +897,140 @@ void P_UnArchiveSpecials (void)
 {
   byte tclass;
 
+  special_after = &thinkercap;   // specials before all mobjs go first
+
   // read in saved thinkers
   while ((tclass = *save_p++) != tc_endspecials)  // killough 2/14/98
     switch (tclass)
       {
       case tc_ceiling:
-        PADSAVEP();
         {
-          ceiling_t *ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
-          memcpy (ceiling, save_p, sizeof(*ceiling));
-          save_p += sizeof(*ceiling);
+          ceiling_t *ceiling =
+            P_LoadSpecial(sizeof *ceiling, (actionf_p1) T_MoveCeiling);
           ceiling->sector = &sectors[(int)ceiling->sector];
           ceiling->sector->ceilingdata = ceiling; //jff 2/22/98
-
-          if (ceiling->thinker.function.acp1)
-            ceiling->thinker.function.acp1 = (actionf_p1) T_MoveCeiling;
-
-          P_AddThinker (&ceiling->thinker);
+          P_AddSpecial (&ceiling->thinker);
           P_AddActiveCeiling(ceiling);
           break;
         }
 
       case tc_door:
-        PADSAVEP();
         {
-          vldoor_t *door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
-          memcpy (door, save_p, sizeof(*door));
-          save_p += sizeof(*door);
+          vldoor_t *door =
+            P_LoadSpecial(sizeof *door, (actionf_p1) T_VerticalDoor);
           door->sector = &sectors[(int)door->sector];
 
           //jff 1/31/98 unarchive line remembered by door as well
           door->line = (int)door->line!=-1? &lines[(int)door->line] : NULL;
 
           door->sector->ceilingdata = door;       //jff 2/22/98
-          door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
-          P_AddThinker (&door->thinker);
+          P_AddSpecial (&door->thinker);
           break;
         }
 
       case tc_floor:
-        PADSAVEP();
         {
-          floormove_t *floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
-          memcpy (floor, save_p, sizeof(*floor));
-          save_p += sizeof(*floor);
+          floormove_t *floor =
+            P_LoadSpecial(sizeof *floor, (actionf_p1) T_MoveFloor);
           floor->sector = &sectors[(int)floor->sector];
           floor->sector->floordata = floor; //jff 2/22/98
-          floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
-          P_AddThinker (&floor->thinker);
+          P_AddSpecial (&floor->thinker);
           break;
         }
 
       case tc_plat:
-        PADSAVEP();
         {
-          plat_t *plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
-          memcpy (plat, save_p, sizeof(*plat));
-          save_p += sizeof(*plat);
+          plat_t *plat =
+            P_LoadSpecial(sizeof *plat, (actionf_p1) T_PlatRaise);
           plat->sector = &sectors[(int)plat->sector];
           plat->sector->floordata = plat; //jff 2/22/98
-
-          if (plat->thinker.function.acp1)
-            plat->thinker.function.acp1 = (actionf_p1) T_PlatRaise;
-
-          P_AddThinker (&plat->thinker);
+          P_AddSpecial (&plat->thinker);
           P_AddActivePlat(plat);
           break;
         }
 
       case tc_flash:
-        PADSAVEP();
         {
-          lightflash_t *flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
-          memcpy (flash, save_p, sizeof(*flash));
-          save_p += sizeof(*flash);
+          lightflash_t *flash =
+            P_LoadSpecial(sizeof *flash, (actionf_p1) T_LightFlash);
           flash->sector = &sectors[(int)flash->sector];
-          flash->thinker.function.acp1 = (actionf_p1) T_LightFlash;
-          P_AddThinker (&flash->thinker);
+          P_AddSpecial (&flash->thinker);
           break;
         }
 
       case tc_strobe:
-        PADSAVEP();
         {
-          strobe_t *strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
-          memcpy (strobe, save_p, sizeof(*strobe));
-          save_p += sizeof(*strobe);
+          strobe_t *strobe =
+            P_LoadSpecial(sizeof *strobe, (actionf_p1) T_StrobeFlash);
           strobe->sector = &sectors[(int)strobe->sector];
-          strobe->thinker.function.acp1 = (actionf_p1) T_StrobeFlash;
-          P_AddThinker (&strobe->thinker);
+          P_AddSpecial (&strobe->thinker);
           break;
         }
 
       //jff 8/8/98 add missing flicker special
       case tc_flicker:
-        PADSAVEP();
         {
-          fireflicker_t *flick = Z_Malloc (sizeof(*flick), PU_LEVEL, NULL);
-          memcpy (flick, save_p, sizeof(*flick));
-          save_p += sizeof(*flick);
+          fireflicker_t *flick =
+            P_LoadSpecial(sizeof *flick, (actionf_p1) T_FireFlicker);
           flick->sector = &sectors[(int)flick->sector];
-          flick->thinker.function.acp1 = (actionf_p1) T_FireFlicker;
-          P_AddThinker (&flick->thinker);
+          P_AddSpecial (&flick->thinker);
           break;
         }
 
       case tc_glow:
-        PADSAVEP();
         {
-          glow_t *glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
-          memcpy (glow, save_p, sizeof(*glow));
-          save_p += sizeof(*glow);
+          glow_t *glow =
+            P_LoadSpecial(sizeof *glow, (actionf_p1) T_Glow);
           glow->sector = &sectors[(int)glow->sector];
-          glow->thinker.function.acp1 = (actionf_p1) T_Glow;
-          P_AddThinker (&glow->thinker);
+          P_AddSpecial (&glow->thinker);
           break;
         }
 
         //jff 2/22/98 new case for elevators
       case tc_elevator:
-        PADSAVEP();
         {
-          elevator_t *elevator = Z_Malloc (sizeof(*elevator), PU_LEVEL, NULL);
-          memcpy (elevator, save_p, sizeof(*elevator));
-          save_p += sizeof(*elevator);
+          elevator_t *elevator =
+            P_LoadSpecial(sizeof *elevator, (actionf_p1) T_MoveElevator);
           elevator->sector = &sectors[(int)elevator->sector];
           elevator->sector->floordata = elevator; //jff 2/22/98
           elevator->sector->ceilingdata = elevator; //jff 2/22/98
-          elevator->thinker.function.acp1 = (actionf_p1) T_MoveElevator;
-          P_AddThinker (&elevator->thinker);
+          P_AddSpecial (&elevator->thinker);
           break;
         }
 
       case tc_scroll:       // killough 3/7/98: scroll effect thinkers
         {
-          scroll_t *scroll = Z_Malloc (sizeof(scroll_t), PU_LEVEL, NULL);
-          memcpy (scroll, save_p, sizeof(scroll_t));
-          save_p += sizeof(scroll_t);
-          scroll->thinker.function.acp1 = (actionf_p1) T_Scroll;
-          P_AddThinker(&scroll->thinker);
+          scroll_t *scroll =
+            P_LoadSpecial(sizeof(scroll_t), (actionf_p1) T_Scroll);
+          P_AddSpecial(&scroll->thinker);
           break;
         }
 
       case tc_friction:   // phares 3/18/98: new friction effect thinkers
         {
-          friction_t *friction = Z_Malloc (sizeof(friction_t), PU_LEVEL, NULL);
-          memcpy (friction, save_p, sizeof(friction_t));
-          save_p += sizeof(friction_t);
-          friction->thinker.function.acp1 = (actionf_p1) T_Friction;
-          P_AddThinker(&friction->thinker);
+          friction_t *friction =
+            P_LoadSpecial(sizeof(friction_t), (actionf_p1) T_Friction);
+          P_AddSpecial(&friction->thinker);
           break;
         }
 
       case tc_pusher:   // phares 3/22/98: new Push/Pull effect thinkers
         {
-          pusher_t *pusher = Z_Malloc (sizeof(pusher_t), PU_LEVEL, NULL);
-          memcpy (pusher, save_p, sizeof(pusher_t));
-          save_p += sizeof(pusher_t);
-          pusher->thinker.function.acp1 = (actionf_p1) T_Pusher;
+          pusher_t *pusher =
+            P_LoadSpecial(sizeof(pusher_t), (actionf_p1) T_Pusher);
           pusher->source = P_GetPushThing(pusher->affectee);
-          P_AddThinker(&pusher->thinker);
+          P_AddSpecial(&pusher->thinker);
+          break;
+        }
+
+      case tc_position:
+        PADSAVEP();
+        {
+          long mobjs;
+          memcpy(&mobjs, save_p, sizeof mobjs);
+          save_p += sizeof mobjs;
+          for (special_after = &mobjthinkercap; mobjs--; )
+            special_after = special_after->mnext;
           break;
         }
 
@@ -38,14 +38,13 @@
 // These are the load / save game routines.
 void P_ArchivePlayers(void);
 void P_UnArchivePlayers(void);
+void P_MarkWorld(void);                  // at the end of P_SetupLevel
 void P_ArchiveWorld(void);
 void P_UnArchiveWorld(void);
 void P_ArchiveThinkers(void);
 void P_UnArchiveThinkers(void);
 void P_ArchiveSpecials(void);
 void P_UnArchiveSpecials(void);
-void P_ThinkerToIndex(void); // phares 9/13/98: save soundtarget in savegame
-void P_IndexToThinker(void); // phares 9/13/98: save soundtarget in savegame
 
 // 1/18/98 killough: add RNG info to savegame
 void P_ArchiveRNG(void);
@@ -44,6 +44,7 @@ rcsid[] = "$Id: p_setup.c,v 1.21 1998/10/13 03:19:21 jim Exp $";
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_enemy.h"
+#include "p_saveg.h"
 #include "s_sound.h"
 #include "lprintf.h" //jff 10/6/98 for debug outputs
 
@@ -1175,6 +1176,7 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   Z_FreeTags(PU_LEVEL, PU_PURGELEVEL-1);
 
   P_InitThinkers();
+  P_ClearMobjHandles();
 
   // if working with a devlopment map, reload it
   //    W_Reload ();     killough 1/31/98: W_Reload obsolete
@@ -1202,6 +1204,7 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   P_LoadSideDefs2 (lumpnum+ML_SIDEDEFS);             //       |
   P_LoadLineDefs2 (lumpnum+ML_LINEDEFS);             // killough 4/4/98
   P_LoadBlockMap  (lumpnum+ML_BLOCKMAP);             // killough 3/1/98
+  P_InitThingGrid ();
   P_LoadSubsectors(lumpnum+ML_SSECTORS);
   P_LoadNodes     (lumpnum+ML_NODES);
   P_LoadSegs      (lumpnum+ML_SEGS);
@@ -1242,6 +1245,10 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
   // set up world state
   P_SpawnSpecials();
 
+  // note how the world starts out, so that savegames need only hold
+  // what has changed since
+  P_MarkWorld();
+
   // preload graphics
   if (precache)
     R_PrecacheLevel();
@@ -55,6 +55,7 @@ rcsid[] = "$Id: p_spec.c,v 1.57 1998/08/14 11:27:27 jim Exp $";
 #include "sounds.h"
 #include "m_bbox.h"                                         // phares 3/20/98
 #include "d_deh.h"
+#include "lprintf.h"
 
 //
 // Animating textures and planes
@@ -2611,6 +2612,7 @@ void T_Scroll(scroll_t *s)
           {
             // Move objects only if on floor or underwater,
             // non-floating, and clipped.
+            P_WakeMobj(thing);
             thing->momx += dx;
             thing->momy += dy;
           }
@@ -2984,8 +2986,14 @@ static void Add_Pusher(int type, int x_mag, int y_mag, mobj_t* source, int affec
 
 pusher_t* tmpusher; // pusher structure for blockmap searches
 
+// Per-level cost of pushers, for -devparm: how many times they ran, and
+// how many things they looked at and pushed in all.
+
+static unsigned long pusherruns, pushertested, pusherpushed;
+
 boolean PIT_PushThing(mobj_t* thing)
     {
+    pushertested++;
     if (thing->player &&
         !(thing->flags & (MF_NOGRAVITY | MF_NOCLIP)))
         {
@@ -3009,28 +3017,53 @@ boolean PIT_PushThing(mobj_t* thing)
             if (tmpusher->source->type == MT_PUSH)
                 pushangle += ANG180;    // away
             pushangle >>= ANGLETOFINESHIFT;
+            P_WakeMobj(thing);
             thing->momx += FixedMul(speed,finecosine[pushangle]);
             thing->momy += FixedMul(speed,finesine[pushangle]);
+            pusherpushed++;
             }
         }
     return true;
     }
 
+/////////////////////////////
+//
+// P_TouchesSector returns true if a thing is in a sector's
+// touching_thinglist, by looking the other way, through the thing's
+// own touching_sectorlist, which is only ever a few nodes long.
+
+static boolean P_TouchesSector(mobj_t *thing, sector_t *sec)
+    {
+    msecnode_t *node;
+
+    for (node = thing->touching_sectorlist ; node ; node = node->m_tnext)
+        if (node->m_sector == sec)
+            return true;
+    return false;
+    }
+
 /////////////////////////////
 //
 // T_Pusher looks for all objects that are inside the radius of
 // the effect.
 //
+// Only things with a player are ever pushed, and those are all MT_PLAYER
+// things (see p_mobj.c), so instead of sweeping the blockmap or the
+// sector's touching_thinglist for them, each pusher goes through the
+// short list of MT_PLAYER things and picks out the ones the sweep would
+// have found. Each thing is pushed on its own, so the order they are
+// visited in does not matter.
+//
 
 void T_Pusher(pusher_t *p)
     {
     sector_t *sec;
     mobj_t   *thing;
-    msecnode_t* node;
     int xspeed,yspeed;
     int xl,xh,yl,yh,bx,by;
     int radius;
     int ht = 0;
+    int i;
 
     if (!allow_pushers)
         return;
@@ -3043,6 +3076,8 @@ void T_Pusher(pusher_t *p)
     if (!(sec->special & PUSH_MASK))
         return;
 
+    pusherruns++;
+
     // For constant pushers (wind/current) there are 3 situations:
     //
     // 1) Affected Thing is above the floor.
@@ -3065,22 +3100,26 @@ void T_Pusher(pusher_t *p)
         {
 
         // Seek out all pushable things within the force radius of this
-        // point pusher. Crosses sectors, so use blockmap.
+        // point pusher. Crosses sectors, so look in the blocks around it,
+        // for the things which are linked into one of them.
 
         tmpusher = p; // MT_PUSH/MT_PULL point source
         radius = p->radius; // where force goes to zero
-        tmbbox[BOXTOP]    = p->y + radius;
-        tmbbox[BOXBOTTOM] = p->y - radius;
-        tmbbox[BOXRIGHT]  = p->x + radius;
-        tmbbox[BOXLEFT]   = p->x - radius;
-
-        xl = (tmbbox[BOXLEFT] - bmaporgx - MAXRADIUS)>>MAPBLOCKSHIFT;
-        xh = (tmbbox[BOXRIGHT] - bmaporgx + MAXRADIUS)>>MAPBLOCKSHIFT;
-        yl = (tmbbox[BOXBOTTOM] - bmaporgy - MAXRADIUS)>>MAPBLOCKSHIFT;
-        yh = (tmbbox[BOXTOP] - bmaporgy + MAXRADIUS)>>MAPBLOCKSHIFT;
-        for (bx=xl ; bx<=xh ; bx++)
-            for (by=yl ; by<=yh ; by++)
-                P_BlockThingsIterator(bx,by,PIT_PushThing);
+
+        xl = (p->x - radius - bmaporgx - MAXRADIUS)>>MAPBLOCKSHIFT;
+        xh = (p->x + radius - bmaporgx + MAXRADIUS)>>MAPBLOCKSHIFT;
+        yl = (p->y - radius - bmaporgy - MAXRADIUS)>>MAPBLOCKSHIFT;
+        yh = (p->y + radius - bmaporgy + MAXRADIUS)>>MAPBLOCKSHIFT;
+        for (i = 0 ; i < numplayerthings ; i++)
+            {
+            thing = playerthings[i];
+            bx = (thing->x - bmaporgx)>>MAPBLOCKSHIFT;
+            by = (thing->y - bmaporgy)>>MAPBLOCKSHIFT;
+            if (bx >= xl && bx <= xh && by >= yl && by <= yh &&
+                bx >= 0 && bx < bmapwidth && by >= 0 && by < bmapheight &&
+                (thing->bprev || blocklinks[by*bmapwidth+bx] == thing))
+                PIT_PushThing(thing);
+            }
         return;
         }
 
@@ -3088,10 +3127,12 @@ void T_Pusher(pusher_t *p)
 
     if (sec->heightsec != -1) // special water sector?
         ht = sectors[sec->heightsec].floorheight;
-    node = sec->touching_thinglist; // things touching this sector
-    for ( ; node ; node = node->m_snext)
+    for (i = 0 ; i < numplayerthings ; i++)
         {
-        thing = node->m_thing;
+        thing = playerthings[i];
+        if (!P_TouchesSector(thing,sec))
+            continue;
+        pushertested++;
         if (!thing->player || (thing->flags & (MF_NOGRAVITY | MF_NOCLIP)))
             continue;
         if (p->type == p_wind)
@@ -3142,11 +3183,28 @@ void T_Pusher(pusher_t *p)
                     yspeed = p->y_mag;
                     }
             }
+        if (xspeed | yspeed)
+          {
+          P_WakeMobj(thing);
+          pusherpushed++;
+          }
         thing->momx += xspeed<<(FRACBITS-PUSH_FACTOR);
         thing->momy += yspeed<<(FRACBITS-PUSH_FACTOR);
         }
     }
 
+/////////////////////////////
+//
+// P_PrintPusherStats reports what pushers cost on the level just
+// finished. Called by G_DoCompleted with -devparm.
+
+void P_PrintPusherStats(void)
+    {
+    if (pusherruns)
+        lprintf(LO_INFO, "Pushers: %lu runs, %lu things looked at, "
+                "%lu pushed\n", pusherruns, pushertested, pusherpushed);
+    }
+
 /////////////////////////////
 //
 // P_GetPushThing() returns a pointer to an MT_PUSH or MT_PULL thing,
@@ -3186,6 +3244,8 @@ static void P_SpawnPushers(void)
     register int s;
     mobj_t* thing;
 
+    pusherruns = pushertested = pusherpushed = 0;
+
     for (i = 0 ; i < numlines ; i++,l++)
         switch(l->special)
             {
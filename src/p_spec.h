@@ -916,6 +916,8 @@ void T_Friction
 void T_Pusher
 ( pusher_t * );      // phares 3/20/98: Push thinker
 
+void P_PrintPusherStats(void);
+
 ////////////////////////////////////////////////////////////////
 //
 // Linedef and sector special handler prototypes
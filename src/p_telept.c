@@ -61,9 +61,9 @@ int EV_Teleport(line_t *line, int side, mobj_t *thing)
   // P_FindSectorFromLineTag instead of simple linear search.
 
   for (i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;)
-    for (thinker=thinkercap.next; thinker!=&thinkercap; thinker=thinker->next)
-      if (thinker->function.acp1 == (actionf_p1) P_MobjThinker &&
-          (m = (mobj_t *) thinker)->type == MT_TELEPORTMAN  &&
+    for (thinker=mobjthinkercap.mnext;
+         thinker!=&mobjthinkercap; thinker=thinker->mnext)
+      if ((m = (mobj_t *) thinker)->type == MT_TELEPORTMAN  &&
             m->subsector->sector-sectors == i)
         {
           fixed_t oldx = thing->x, oldy = thing->y, oldz = thing->z;
@@ -123,9 +123,9 @@ int EV_SilentTeleport(line_t *line, int side, mobj_t *thing)
     return 0;
 
   for (i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;)
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
-      if (th->function.acp1 == (actionf_p1) P_MobjThinker &&
-          (m = (mobj_t *) th)->type == MT_TELEPORTMAN  &&
+    for (th = mobjthinkercap.mnext;
+         th != &mobjthinkercap; th = th->mnext)
+      if ((m = (mobj_t *) th)->type == MT_TELEPORTMAN  &&
           m->subsector->sector-sectors == i)
         {
           // Height of thing above ground, in case of mid-air teleports:
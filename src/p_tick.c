@@ -34,6 +34,7 @@ rcsid[] = "$Id: p_tick.c,v 1.7 1998/05/15 00:37:56 killough Exp $";
 #include "p_user.h"
 #include "p_spec.h"
 #include "p_tick.h"
+#include "p_mobj.h"
 
 int leveltime;
 
@@ -48,6 +49,9 @@ int leveltime;
 // Both the head and tail of the thinker list.
 thinker_t thinkercap;
 
+// Both the head and tail of the mobj list.
+thinker_t mobjthinkercap;
+
 //
 // P_InitThinkers
 //
@@ -55,6 +59,8 @@ thinker_t thinkercap;
 void P_InitThinkers(void)
 {
   thinkercap.prev = thinkercap.next  = &thinkercap;
+  thinkercap.aprev = thinkercap.anext = &thinkercap;
+  mobjthinkercap.mprev = mobjthinkercap.mnext = &mobjthinkercap;
 }
 
 //
@@ -68,6 +74,88 @@ void P_AddThinker(thinker_t* thinker)
   thinker->next = &thinkercap;
   thinker->prev = thinkercap.prev;
   thinkercap.prev = thinker;
+
+  thinkercap.aprev->anext = thinker;    // and to the end of the run list
+  thinker->anext = &thinkercap;
+  thinker->aprev = thinkercap.aprev;
+  thinkercap.aprev = thinker;
+
+  thinker->references = 0;
+
+  if (thinker->function.acp1 == (actionf_p1) P_MobjThinker)
+    {                                   // and mobjs to the end of theirs
+      thinker->mnext = &mobjthinkercap;
+      (thinker->mprev = mobjthinkercap.mprev)->mnext = thinker;
+      mobjthinkercap.mprev = thinker;
+    }
+  else
+    thinker->mprev = NULL;
+}
+
+//
+// P_SleepThinker
+//
+// Takes a thinker off the run list, so that P_RunThinkers skips it until
+// it is woken again. Only for thinkers which would do nothing if run.
+// anext is left alone, so P_RunThinkers can still step past a thinker
+// which put itself to sleep.
+//
+
+void P_SleepThinker(thinker_t *thinker)
+{
+  if (thinker->aprev)
+    {
+      (thinker->anext->aprev = thinker->aprev)->anext = thinker->anext;
+      thinker->aprev = NULL;
+    }
+}
+
+//
+// P_WakeThinker
+//
+// Puts a dormant thinker back on the run list, in its old place, which
+// is just after the closest thinker before it in the main list which is
+// not dormant. Its relative order must be kept for demo sync.
+//
+
+void P_WakeThinker(thinker_t *thinker)
+{
+  thinker_t *prev;
+
+  if (thinker->aprev)
+    return;
+
+  for (prev = thinker->prev; !prev->aprev; prev = prev->prev)
+    ;                                   // thinkercap is never dormant
+
+  thinker->aprev = prev;
+  (thinker->anext = prev->anext)->aprev = thinker;
+  prev->anext = thinker;
+}
+
+//
+// P_MoveThinker
+//
+// Moves a thinker to just after another one in the main list, keeping
+// the run list in the same order. Used to put back the order of the
+// thinkers in a savegame, which P_AddThinker alone would lose.
+//
+
+void P_MoveThinker(thinker_t *thinker, thinker_t *after)
+{
+  if (thinker == after || thinker->prev == after)
+    return;
+
+  (thinker->next->prev = thinker->prev)->next = thinker->next;
+  (thinker->next = after->next)->prev = thinker;
+  (thinker->prev = after)->next = thinker;
+
+  if (thinker->aprev)                   // refile it on the run list
+    {
+      (thinker->anext->aprev = thinker->aprev)->anext = thinker->anext;
+      thinker->aprev = NULL;
+      P_WakeThinker(thinker);
+    }
 }
 
 //
@@ -79,7 +167,11 @@ void P_AddThinker(thinker_t* thinker)
 
 void P_RemoveThinkerDelayed(thinker_t *thinker)
 {
-  thinker->function.acv = P_RemoveThinker;
+  // Dormant mobjs do not run the target check in P_MobjThinker, so they
+  // count their references instead, and the deletion waits for them.
+
+  if (!thinker->references)
+    thinker->function.acv = P_RemoveThinker;
 }
 
 //
@@ -98,6 +190,18 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
 void P_RemoveThinker(thinker_t *thinker)
 {
   thinker->function.acv = P_RemoveThinkerDelayed;
+
+  P_WakeThinker(thinker);               // so that P_RunThinkers frees it
+
+  // Take it off the mobj list now, so that mobj walks never see a
+  // removed thinker. mnext is left alone, so a walk which is standing
+  // on this thinker can still step past it.
+
+  if (thinker->mprev)
+    {
+      (thinker->mnext->mprev = thinker->mprev)->mnext = thinker->mnext;
+      thinker->mprev = NULL;
+    }
 }
 
 //
@@ -122,15 +226,25 @@ void P_RemoveThinker(thinker_t *thinker)
 // P_RemoveThinkerDelayed() so that its deletion is delayed another tic.
 // This fixes some Doom crashes. killough
 //
+// Thinkers are run in the order of the global list, not kind by kind.
+// The RNG calls and sector movement of different kinds of thinkers are
+// interleaved, so running them in any other order would break demo sync.
+//
+// Only the run list is walked, which is the global list less the dormant
+// thinkers, in the same order. Dormant thinkers would do nothing if run.
+//
 
 static void P_RunThinkers (void)
 {
-  register thinker_t *currentthinker = thinkercap.next;
+  register thinker_t *currentthinker = thinkercap.anext;
+
   while (currentthinker != &thinkercap)
     if (currentthinker->function.acv == P_RemoveThinker)
       {
-        register thinker_t *next = currentthinker->next;  // Load next pointer
-        (next->prev = currentthinker->prev)->next = next; // Remove from list
+        register thinker_t *next = currentthinker->anext; // Load next pointer
+        (currentthinker->next->prev = currentthinker->prev)->next =
+          currentthinker->next;                           // Remove from list
+        (next->aprev = currentthinker->aprev)->anext = next;
         Z_Free(currentthinker);                           // Free the node
         currentthinker = next;                            // Go to next node
       }
@@ -138,7 +252,7 @@ static void P_RunThinkers (void)
       {
         if (currentthinker->function.acp1)                // Call function
           currentthinker->function.acp1(currentthinker);  // (may insert nodes)
-        currentthinker = currentthinker->next;            // Get next node
+        currentthinker = currentthinker->anext;           // Get next node
       }
 }
 
@@ -40,10 +40,20 @@ void P_Ticker(void);
 
 extern thinker_t thinkercap;  // Both the head and tail of the thinker list
 
+// Mobj thinkers are also on the mobj list, in the order they were added,
+// in addition to the global list above. The global list still decides
+// the order thinkers run in, since demo sync depends on it; the mobj list
+// is for walks which only want mobjs.
+
+extern thinker_t mobjthinkercap;  // Both the head and tail of the mobj list
+
 void P_InitThinkers(void);
 void P_AddThinker(thinker_t *thinker);
 void P_RemoveThinker(thinker_t *thinker);
 void P_RemoveThinkerDelayed(thinker_t *thinker);    // killough 4/25/98
+void P_SleepThinker(thinker_t *thinker);
+void P_WakeThinker(thinker_t *thinker);
+void P_MoveThinker(thinker_t *thinker, thinker_t *after);
 
 #endif
 
@@ -256,6 +256,9 @@ void P_PlayerThink (player_t* player)
   ticcmd_t*    cmd;
   weapontype_t newweapon;
 
+  // for frames drawn between tics
+  P_SavePosition (player->mo);
+
   // killough 2/8/98, 3/21/98:
   if (player->cheats & CF_NOCLIP)
     player->mo->flags |= MF_NOCLIP;
@@ -59,7 +59,9 @@ unsigned  maxdrawsegs;
 
 void R_ClearDrawSegs(void)
 {
-  ds_p = drawsegs;
+  if (!maxdrawsegs)
+    maxdrawsegs = 128;
+  ds_p = drawsegs = R_FrameAlloc(maxdrawsegs * sizeof *drawsegs);
 }
 
 //
@@ -35,6 +35,7 @@ rcsid[] = "$Id: r_data.c,v 1.24 1998/09/07 20:11:45 jim Exp $";
 #include "w_wad.h"
 #include "r_main.h"
 #include "r_sky.h"
+#include "p_tick.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
 
 //
@@ -919,9 +920,9 @@ void R_PrecacheLevel(void)
 
   {
     thinker_t *th;
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
-      if (th->function.acp1 == (actionf_p1)P_MobjThinker)
-        hitlist[((mobj_t *)th)->sprite] = 1;
+    for (th = mobjthinkercap.mnext;
+         th != &mobjthinkercap; th=th->mnext)
+      hitlist[((mobj_t *)th)->sprite] = 1;
   }
 
   for (i=numsprites; --i >= 0;)
@@ -320,6 +320,7 @@ typedef struct
 
 typedef struct vissprite_s
 {
+  struct vissprite_s *next;    // previous one projected this frame
   int x1, x2;
   fixed_t gx, gy;              // for line side calculation
   fixed_t gz, gzt;             // global bottom / top for silhouette clipping
@@ -40,6 +40,8 @@ static const char rcsid[] = "$Id: r_main.c,v 1.14 1998/09/07 20:11:36 jim Exp $"
 #include "m_bbox.h"
 #include "r_sky.h"
 #include "v_video.h"
+#include "i_system.h"
+#include "g_game.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
 
 // Fineangles in the SCREENWIDTH wide window.
@@ -329,6 +331,70 @@ void R_SetViewSize(int blocks)
   setblocks = blocks;
 }
 
+//
+// Automatic view size
+//
+// With auto_viewsize, the time R_RenderPlayerView takes is averaged over
+// frames and held against auto_viewsize_ms. When it is over, the view is
+// made a size smaller. When a size larger would still fit with a quarter
+// to spare, the view grows again, up to the size set in the menu. The
+// time is taken to go with the view's area. A size is kept for at least
+// a second, so that the view does not flicker between two sizes.
+//
+
+int auto_viewsize;          // 1 to size the view to the time it takes
+int auto_viewsize_ms;       // the time it may take, in milliseconds
+
+extern int screenblocks;
+
+static int viewtime;        // the average time taken, in 1/256 ms
+static int viewsizetime;    // when the size last changed
+
+static int R_ViewArea(int blocks)
+{
+  return blocks == 11 ? SCREENWIDTH*SCREENHEIGHT :
+    blocks*32 * ((blocks*168/10) & ~7);
+}
+
+static void R_AutoViewSize(int ms)
+{
+  int blocks = setblocks, now = I_GetTimeMS();
+
+  viewtime += (ms*256 - viewtime) >> 3;
+
+  if (now - viewsizetime < 1000)
+    return;
+
+  if (viewtime > auto_viewsize_ms*256 && blocks > 3)
+    blocks--;
+  else
+    if (blocks < screenblocks &&
+        (long long) viewtime * R_ViewArea(blocks+1) <
+        (long long) auto_viewsize_ms*192 * R_ViewArea(blocks))
+      blocks++;
+
+  if (blocks != setblocks)
+    {
+      viewtime = (long long) viewtime * R_ViewArea(blocks) /
+        R_ViewArea(setblocks);
+      viewsizetime = now;
+      R_SetViewSize(blocks);
+    }
+}
+
+//
+// Frames between tics
+//
+// With uncapped_framerate, frames are drawn as often as they can be
+// rather than once a tic. Each shows the view and things part of the way,
+// interpfrac, from where they were at the start of the last tic to where
+// it left them, according to how far into the next tic the frame is drawn.
+// Things keep where they were in prevx etc. (see P_SavePosition).
+//
+
+int     uncapped_framerate;   // 1 to draw frames between tics
+fixed_t interpfrac;           // FRACUNIT if not drawing between tics
+
 //
 // R_ExecuteSetViewSize
 //
@@ -411,8 +477,6 @@ void R_ExecuteSetViewSize (void)
 // R_Init
 //
 
-extern int screenblocks;
-
 void R_Init (void)
 {
   R_InitData();
@@ -429,6 +493,86 @@ void R_Init (void)
   lprintf(LO_INFO,"R_InitTranslationsTables\n");
 }
 
+//
+// Frame arena
+//
+// Transient data built while rendering a frame (vissprites, drawsegs,
+// openings and visplanes) is carved from one chunk of memory, which is
+// emptied in a single step at the start of R_RenderPlayerView. The chunk
+// is sized from the high water mark of previous frames, so once it has
+// adapted to a scene, rendering does no allocation at all. A frame which
+// needs more gets overflow chunks, which are merged at the next reset.
+//
+
+#define FRAME_ALIGN    8            // alignment of R_FrameAlloc results
+#define FRAME_MINSIZE  (64*1024)    // smallest chunk allocated
+
+typedef struct frame_chunk_s {
+  struct frame_chunk_s *next;       // chunk filled up earlier this frame
+  size_t size, used;
+} frame_chunk_t;
+
+#define FRAME_HEADER ((sizeof(frame_chunk_t)+FRAME_ALIGN-1)&~(FRAME_ALIGN-1))
+
+static frame_chunk_t *frame_chunk;  // chunk currently carved from
+static size_t frame_used;           // bytes carved this frame
+static size_t frame_peak;           // slowly decaying high water mark
+
+void *R_FrameAlloc(size_t size)
+{
+  frame_chunk_t *chunk = frame_chunk;
+
+  size = (size + FRAME_ALIGN-1) & ~(FRAME_ALIGN-1);
+  frame_used += size;
+
+  if (chunk->used + size > chunk->size)       // Out of room, overflow
+    {
+      size_t n = size > chunk->size ? size : chunk->size;
+      chunk = Z_Malloc(FRAME_HEADER + n, PU_STATIC, 0);
+      chunk->next = frame_chunk;
+      chunk->size = n;
+      chunk->used = 0;
+      frame_chunk = chunk;
+    }
+
+  chunk->used += size;
+  return (char *) chunk + FRAME_HEADER + chunk->used - size;
+}
+
+static void R_ResetFrameArena(void)
+{
+  frame_chunk_t *chunk = frame_chunk;
+  size_t want;
+
+  if (frame_used > frame_peak)
+    frame_peak = frame_used;
+  else                              // Decay over a few hundred frames
+    frame_peak -= (frame_peak - frame_used) >> 8;
+  frame_used = 0;
+
+  want = frame_peak + frame_peak/4; // Leave some room to grow
+  if (want < FRAME_MINSIZE)
+    want = FRAME_MINSIZE;
+
+  // Replace the chunk if it overflowed, or is much bigger than needed
+
+  if (!chunk || chunk->next || chunk->size < frame_peak ||
+      chunk->size > want*2)
+    {
+      while (chunk)
+        {
+          frame_chunk_t *next = chunk->next;
+          Z_Free(chunk);
+          chunk = next;
+        }
+      chunk = frame_chunk = Z_Malloc(FRAME_HEADER + want, PU_STATIC, 0);
+      chunk->next = NULL;
+      chunk->size = want;
+    }
+
+  chunk->used = 0;
+}
+
 //
 // R_PointInSubsector
 //
@@ -449,14 +593,40 @@ subsector_t *R_PointInSubsector(fixed_t x, fixed_t y)
 void R_SetupFrame (player_t *player)
 {               
   int i, cm;
+  mobj_t *mo = player->mo;
     
   viewplayer = player;
-  viewx = player->mo->x;
-  viewy = player->mo->y;
-  viewangle = player->mo->angle + viewangleoffset;
-  extralight = player->extralight;
 
-  viewz = player->viewz;
+  // Frames are drawn between tics with uncapped_framerate, unless the clock
+  // runs at other than real time, or the game is not running
+  interpfrac = !uncapped_framerate || singletics ||
+    I_GetTime != I_GetTime_RealTime || gamestate != GS_LEVEL || paused ||
+    (!netgame && menuactive && !demoplayback) ? FRACUNIT : I_GetFracTime();
+
+  if (interpfrac < FRACUNIT && mo->prevtic == leveltime-1)
+    {
+      viewx = mo->prevx + FixedMul(interpfrac, mo->x - mo->prevx);
+      viewy = mo->prevy + FixedMul(interpfrac, mo->y - mo->prevy);
+      viewz = mo->prevviewz +
+        FixedMul(interpfrac, player->viewz - mo->prevviewz);
+      viewangle = mo->prevangle +
+        FixedMul(interpfrac, (int) (mo->angle - mo->prevangle));
+    }
+  else
+    {
+      viewx = mo->x;
+      viewy = mo->y;
+      viewz = player->viewz;
+      viewangle = mo->angle;
+    }
+
+  // the player at the keyboard sees turning as soon as it is made
+  if (interpfrac < FRACUNIT && player == &players[consoleplayer] &&
+      !demoplayback)
+    viewangle = mo->angle + ((angle_t) G_PendingTurn() << 16);
+
+  viewangle += viewangleoffset;
+  extralight = player->extralight;
     
   viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
   viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -504,6 +674,9 @@ int autodetect_hom = 0;       // killough 2/7/98: HOM autodetection flag
 //
 void R_RenderPlayerView (player_t* player)
 {       
+  int starttime = auto_viewsize ? I_GetTimeMS() : 0;
+
+  R_ResetFrameArena ();
   R_SetupFrame (player);
 
   // Clear buffers.
@@ -601,6 +774,9 @@ void R_RenderPlayerView (player_t* player)
 
   // Check for new console commands.
   NetUpdate ();
+
+  if (auto_viewsize)
+    R_AutoViewSize(I_GetTimeMS() - starttime);
 }
 
 //----------------------------------------------------------------------------
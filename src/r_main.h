@@ -112,6 +112,14 @@ void R_RenderPlayerView(player_t *player);   // Called by G_Drawer.
 void R_Init(void);                           // Called by startup code.
 void R_SetViewSize(int blocks);              // Called by M_Responder.
 
+extern int auto_viewsize;      // size the view to the time it takes
+extern int auto_viewsize_ms;
+
+extern int uncapped_framerate; // draw frames between tics
+extern fixed_t interpfrac;     // how far between them, out of FRACUNIT
+
+void *R_FrameAlloc(size_t size);   // Transient data, freed at next frame
+
 #endif
 
 //----------------------------------------------------------------------------
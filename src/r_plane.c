@@ -55,8 +55,6 @@ rcsid[] = "$Id: r_plane.c,v 1.8 1998/05/03 23:09:53 killough Exp $";
 #define MAXVISPLANES 128    /* must be a power of 2 */
 
 static visplane_t *visplanes[MAXVISPLANES];   // killough
-static visplane_t *freetail;                  // killough
-static visplane_t **freehead = &freetail;     // killough
 visplane_t *floorplane, *ceilingplane;
 
 // killough -- hash function for visplanes
@@ -65,8 +63,8 @@ visplane_t *floorplane, *ceilingplane;
 #define visplane_hash(picnum,lightlevel,height) \
   ((unsigned)((picnum)*3+(lightlevel)+(height)*7) & (MAXVISPLANES-1))
 
-size_t maxopenings;
-short *openings,*lastopening;
+size_t maxopenings = 16384;
+short *openings,*lastopening;       // current block of openings
 
 // Clip values are the solid pixel bounding the range.
 //  floorclip starts out SCREENHEIGHT
@@ -181,11 +179,12 @@ void R_ClearPlanes(void)
   for (i=0 ; i<viewwidth ; i++)
     floorclip[i] = viewheight, ceilingclip[i] = -1;
 
-  for (i=0;i<MAXVISPLANES;i++)    // new code -- killough
-    for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead; )
-      freehead = &(*freehead)->next;
+  // Visplanes and openings come from the frame arena, which has been
+  // emptied already, so this just forgets the last frame's ones.
 
-  lastopening = openings;
+  memset(visplanes, 0, sizeof visplanes);
+
+  lastopening = openings = R_FrameAlloc(maxopenings * sizeof *openings);
 
   // texture calculation
   memset (cachedheight, 0, sizeof(cachedheight));
@@ -202,12 +201,7 @@ void R_ClearPlanes(void)
 
 static visplane_t *new_visplane(unsigned hash)
 {
-  visplane_t *check = freetail;
-  if (!check)
-    check = calloc(1, sizeof *check);
-  else
-    if (!(freetail = freetail->next))
-      freehead = &freetail;
+  visplane_t *check = R_FrameAlloc(sizeof *check);
   check->next = visplanes[hash];
   visplanes[hash] = check;
   return check;
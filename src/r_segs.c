@@ -410,11 +410,12 @@ void R_StoreWallRange(const int start, const int stop)
   if (ds_p == drawsegs+maxdrawsegs)   // killough 1/98 -- fix 2s line HOM
     {
       unsigned pos = ds_p - drawsegs; // jff 8/9/98 fix from ZDOOM1.14a
-      unsigned newmax = maxdrawsegs ? maxdrawsegs*2 : 128; // killough
-      drawsegs = realloc(drawsegs,newmax*sizeof(*drawsegs));
-//      ds_p = drawsegs+maxdrawsegs;
+      unsigned newmax = maxdrawsegs*2; // killough
+      drawseg_t *newds = R_FrameAlloc(newmax*sizeof(*drawsegs));
+      memcpy(newds, drawsegs, pos*sizeof(*drawsegs));  // old copy stays in
+      drawsegs = newds;                                // frame arena
       ds_p = drawsegs + pos;          // jff 8/9/98 fix from ZDOOM1.14a
-      maxdrawsegs = newmax;
+      maxdrawsegs = newmax;           // next frame starts out this big
     }
 
 #ifdef RANGECHECK
@@ -450,32 +451,17 @@ void R_StoreWallRange(const int start, const int stop)
   {     // killough 1/6/98, 2/1/98: remove limit on openings
     extern short *openings;
     extern size_t maxopenings;
-    size_t pos = lastopening - openings;
-    size_t need = (rw_stopx - start)*4 + pos;
-    if (need > maxopenings)
-      {
-        drawseg_t *ds;                //jff 8/9/98 needed for fix from ZDoom
-        short *oldopenings = openings;
-        short *oldlast = lastopening;
+    size_t need = (rw_stopx - start)*4;
+
+    // Openings already handed out to drawsegs stay where they are in the
+    // frame arena; further ones come from a new, larger block of openings.
 
+    if (need + (lastopening - openings) > maxopenings)
+      {
         do
-          maxopenings = maxopenings ? maxopenings*2 : 16384;
+          maxopenings *= 2;
         while (need > maxopenings);
-        openings = realloc(openings, maxopenings * sizeof(*openings));
-        lastopening = openings + pos;
-
-      // jff 8/9/98 borrowed fix for openings from ZDOOM1.14
-      // [RH] We also need to adjust the openings pointers that
-      //    were already stored in drawsegs.
-      for (ds = drawsegs; ds < ds_p; ds++)
-        {
-#define ADJUST(p) if (ds->p + ds->x1 >= oldopenings && ds->p + ds->x1 <= oldlast)\
-            ds->p = ds->p - oldopenings + openings;
-          ADJUST (maskedtexturecol);
-          ADJUST (sprtopclip);
-          ADJUST (sprbottomclip);
-        }
-#undef ADJUST
+        lastopening = openings = R_FrameAlloc(maxopenings*sizeof(*openings));
       }
   }  // killough: end of code to remove limits on openings
 
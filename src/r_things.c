@@ -258,8 +258,10 @@ void R_InitSpriteDefs(char **namelist)
 // GAME FUNCTIONS
 //
 
-static vissprite_t *vissprites, **vissprite_ptrs;  // killough
-static size_t num_vissprite, num_vissprite_alloc, num_vissprite_ptrs;
+// Vissprites live in the frame arena, chained newest first -- killough
+
+static vissprite_t *vissprites, **vissprite_ptrs;
+static size_t num_vissprite;
 
 //
 // R_InitSprites
@@ -282,6 +284,7 @@ void R_InitSprites(char **namelist)
 void R_ClearSprites (void)
 {
   num_vissprite = 0;            // killough
+  vissprites = NULL;
 }
 
 //
@@ -290,12 +293,10 @@ void R_ClearSprites (void)
 
 vissprite_t *R_NewVisSprite(void)
 {
-  if (num_vissprite >= num_vissprite_alloc)             // killough
-    {
-      num_vissprite_alloc = num_vissprite_alloc ? num_vissprite_alloc*2 : 128;
-      vissprites = realloc(vissprites,num_vissprite_alloc*sizeof(*vissprites));
-    }
- return vissprites + num_vissprite++;
+  vissprite_t *vis = R_FrameAlloc(sizeof *vis);
+  vis->next = vissprites;
+  num_vissprite++;
+  return vissprites = vis;
 }
 
 //
@@ -426,15 +427,26 @@ void R_ProjectSprite (mobj_t* thing)
   vissprite_t *vis;
   fixed_t   iscale;
   int heightsec;      // killough 3/27/98
+  fixed_t tr_x, tr_y, gxt, gyt, tz;
+
+  // where the thing is drawn, part way along its last move between tics
+  fixed_t fx = thing->x, fy = thing->y, fz = thing->z;
+
+  if (interpfrac < FRACUNIT && thing->prevtic == leveltime-1)
+    {
+      fx = thing->prevx + FixedMul(interpfrac, fx - thing->prevx);
+      fy = thing->prevy + FixedMul(interpfrac, fy - thing->prevy);
+      fz = thing->prevz + FixedMul(interpfrac, fz - thing->prevz);
+    }
 
   // transform the origin point
-  fixed_t tr_x = thing->x - viewx;
-  fixed_t tr_y = thing->y - viewy;
+  tr_x = fx - viewx;
+  tr_y = fy - viewy;
 
-  fixed_t gxt = FixedMul(tr_x,viewcos);
-  fixed_t gyt = -FixedMul(tr_y,viewsin);
+  gxt = FixedMul(tr_x,viewcos);
+  gyt = -FixedMul(tr_y,viewsin);
 
-  fixed_t tz = gxt-gyt;
+  tz = gxt-gyt;
 
     // thing is behind view plane?
   if (tz < MINZ)
@@ -469,7 +481,7 @@ void R_ProjectSprite (mobj_t* thing)
   if (sprframe->rotate)
     {
       // choose a different rotation based on player view
-      angle_t ang = R_PointToAngle(thing->x, thing->y);
+      angle_t ang = R_PointToAngle(fx, fy);
       unsigned rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
       lump = sprframe->lump[rot];
       flip = (boolean) sprframe->flip[rot];
@@ -496,10 +508,10 @@ void R_ProjectSprite (mobj_t* thing)
   if (x2 < 0)
     return;
 
-  gzt = thing->z + spritetopoffset[lump];
+  gzt = fz + spritetopoffset[lump];
 
   // killough 4/9/98: clip things which are out of view due to height
-  if (thing->z > viewz + FixedDiv(centeryfrac, xscale) ||
+  if (fz > viewz + FixedDiv(centeryfrac, xscale) ||
       gzt      < viewz - FixedDiv(centeryfrac-viewheight, xscale))
     return;
 
@@ -513,13 +525,13 @@ void R_ProjectSprite (mobj_t* thing)
     {
       int phs = viewplayer->mo->subsector->sector->heightsec;
       if (phs != -1 && viewz < sectors[phs].floorheight ?
-          thing->z >= sectors[heightsec].floorheight :
+          fz >= sectors[heightsec].floorheight :
           gzt < sectors[heightsec].floorheight)
         return;
       if (phs != -1 && viewz > sectors[phs].ceilingheight ?
           gzt < sectors[heightsec].ceilingheight &&
           viewz >= sectors[heightsec].ceilingheight :
-          thing->z >= sectors[heightsec].ceilingheight)
+          fz >= sectors[heightsec].ceilingheight)
         return;
     }
 
@@ -531,9 +543,9 @@ void R_ProjectSprite (mobj_t* thing)
 
   vis->mobjflags = thing->flags;
   vis->scale = xscale; /* <<detailshift; obsolete -- killough */
-  vis->gx = thing->x;
-  vis->gy = thing->y;
-  vis->gz = thing->z;
+  vis->gx = fx;
+  vis->gy = fy;
+  vis->gz = fz;
   vis->gzt = gzt;                          // killough 3/27/98
   vis->texturemid = vis->gzt - viewz;
   vis->x1 = x1 < 0 ? 0 : x1;
@@ -744,19 +756,14 @@ void R_SortVisSprites (void)
   if (num_vissprite)
     {
       int i = num_vissprite;
+      vissprite_t *vis = vissprites;
 
-      // If we need to allocate more pointers for the vissprites,
-      // allocate as many as were allocated for sprites -- killough
+      // Pointers go in projection order, which the chain has reversed
 
-      if (num_vissprite_ptrs < num_vissprite)
-        {
-          free(vissprite_ptrs);  // better than realloc -- no preserving needed
-          vissprite_ptrs = malloc((num_vissprite_ptrs=num_vissprite_alloc) *
-                                  sizeof(*vissprite_ptrs));
-        }
+      vissprite_ptrs = R_FrameAlloc(num_vissprite * sizeof(*vissprite_ptrs));
 
       while (--i>=0)
-        vissprite_ptrs[i] = vissprites+i;
+        vissprite_ptrs[i] = vis, vis = vis->next;
 
       // qsort is probably overkill for ~10-100 sprites, but what the heck
       // It's been tested on > 100 sprites and works well enough -- killough
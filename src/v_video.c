@@ -26,6 +26,7 @@
 //  Gamma correction LUT stuff.
 //  Color range translation support
 //  Functions to draw patches (by post) directly to screen.
+//  Row span rasters of patches, for drawing them again quickly.
 //  Functions to blit a block to the screen.
 //
 //-----------------------------------------------------------------------------
@@ -247,6 +248,328 @@ void V_CopyRect(int srcx, int srcy, int srcscrn, int width,
     }
 }
 
+//
+// Patch rasters
+//
+// Drawing a patch column by column steps down the screen a pixel at a
+// time, and the status bar, HUD font, menus and intermission draw the
+// same patches over and over. So each patch, with its translation and
+// flip, is converted once into the runs of opaque pixels along each of
+// its rows, which are then drawn with memcpy.
+//
+// Rasters are purgable, and are found by the patch's address. A raster
+// is only used while that address still holds the lump it was made from,
+// so a patch which has been purged, and whose memory has gone to some
+// other lump, is never drawn from a stale raster.
+//
+// A raster is a rasterhead_t, the caller's data if any, then for each row
+// the number of runs and the column and length of each, all shorts, and
+// then the pixels of all the runs, in order.
+//
+
+typedef struct {
+  short x, y;                     // where an overlay goes; 0 for patches
+  short width, height;
+  int   extra;                    // bytes of caller's data which follow
+  int   nshorts;                  // shorts of runs after that
+} rasterhead_t;
+
+typedef struct {
+  const patch_t *patch;
+  const char    *outr;            // translation, or NULL
+  int           flip;
+  int           lump;
+  byte          *raster;          // PU_CACHE, NULL once purged
+} patchraster_t;
+
+#define RASTERSETS 128            // a small set-associative cache
+#define RASTERWAYS 4
+
+static patchraster_t patchrasters[RASTERSETS][RASTERWAYS];
+static int           nextway[RASTERSETS];
+static const patch_t *notlump[RASTERSETS];  // last patch found not a lump
+
+// Scratch space for converting a patch or overlay; larger patches are
+// not cached. The mask is all clear between conversions, each clearing
+// only what it marked, since overlays are remade often.
+static byte rasterpix[SCREENWIDTH*SCREENHEIGHT];
+static byte rastermask[SCREENWIDTH*SCREENHEIGHT];
+
+// Returns the number of rows a patch's posts reach down to, which may
+// be more than its height.
+
+static int V_PatchRows(const patch_t *patch)
+{
+  int w = SHORT(patch->width), h = 0, col;
+  const column_t *column;
+
+  for (col = 0; col < w; col++)
+    for (column = (const column_t *)((const byte *) patch +
+                                     LONG(patch->columnofs[col]));
+         column->topdelta != 0xff;
+         column = (const column_t *)((const byte *) column +
+                                     column->length + 4))
+      if (column->topdelta + column->length > h)
+        h = column->topdelta + column->length;
+  return h;
+}
+
+// Puts a patch's pixels into the scratch space at offset ofs, marking
+// them opaque, in rows of pitch bytes, and leaving out any past rows.
+
+static void V_MaskPatch(const patch_t *patch, int ofs, int pitch, int rows,
+                        const char *outr, int flip)
+{
+  int w = SHORT(patch->width), col;
+  const column_t *column;
+
+  for (col = 0; col < w; col++)
+    for (column = (const column_t *)((const byte *) patch +
+                                     LONG(patch->columnofs[col]));
+         column->topdelta != 0xff;
+         column = (const column_t *)((const byte *) column +
+                                     column->length + 4))
+      {
+        const byte *source = (const byte *) column + 3;
+        int count = column->length;
+        int i = ofs + column->topdelta*pitch + (flip ? w-1-col : col);
+
+        if (count > rows - column->topdelta)
+          count = rows - column->topdelta;
+        for (; count > 0; count--, i += pitch)
+          {
+            rasterpix[i] = outr ? outr[*source++] : *source++;
+            rastermask[i] = 1;
+          }
+      }
+}
+
+// Makes a raster of the width by height pixels at offset ofs in the
+// scratch space, with room for extra bytes of the caller's.
+
+static byte *V_EncodeRaster(int ofs, int pitch, int width, int height,
+                            size_t extra, void **user)
+{
+  rasterhead_t *head;
+  unsigned short *spans;
+  byte *raster, *pix;
+  int x, y, nshorts, npix;
+
+  extra = (extra + sizeof(int) - 1) & ~(sizeof(int) - 1);
+
+  for (nshorts = height, npix = y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      if (rastermask[ofs + y*pitch + x])
+        {
+          npix++;
+          if (!x || !rastermask[ofs + y*pitch + x-1])
+            nshorts += 2;
+        }
+
+  raster = Z_Malloc(sizeof *head + extra + nshorts*sizeof *spans + npix,
+                    PU_CACHE, user);
+  head = (rasterhead_t *) raster;
+  head->x = head->y = 0;
+  head->width = width;
+  head->height = height;
+  head->extra = extra;
+  head->nshorts = nshorts;
+  spans = (unsigned short *)(raster + sizeof *head + extra);
+  pix = (byte *)(spans + nshorts);
+
+  for (y = 0; y < height; y++, ofs += pitch)
+    {
+      unsigned short *runs = spans++;
+      for (*runs = x = 0; x < width; )
+        if (!rastermask[ofs+x])
+          x++;
+        else
+          {
+            int start = x;
+            while (x < width && rastermask[ofs+x])
+              *pix++ = rasterpix[ofs + x++];
+            *spans++ = start;
+            *spans++ = x - start;
+            ++*runs;
+          }
+    }
+  return raster;
+}
+
+static byte *V_RasterizePatch(const patch_t *patch, const char *outr,
+                              int flip, void **user)
+{
+  int w = SHORT(patch->width), h = V_PatchRows(patch);
+  byte *raster;
+
+  if (w > SCREENWIDTH || h > SCREENHEIGHT)
+    return NULL;
+
+  V_MaskPatch(patch, 0, w, h, outr, flip);
+  raster = V_EncodeRaster(0, w, w, h, 0, user);  // patch is not needed now
+  memset(rastermask, 0, w*h);
+  return raster;
+}
+
+// Returns the raster of a patch, making it if need be, or NULL if the
+// patch is not a cached lump or is too large.
+
+static const byte *V_PatchRaster(const patch_t *patch, const char *outr,
+                                 int flip)
+{
+  int set = (int)(((unsigned long) patch >> 3 ^ (unsigned long) outr >> 3
+                   ^ flip) % RASTERSETS);
+  patchraster_t *r = patchrasters[set];
+  int i, lump;
+
+  for (i = 0; i < RASTERWAYS; i++)
+    if (r[i].raster && r[i].patch == patch && r[i].outr == outr &&
+        r[i].flip == flip)
+      {
+        if (lumpcache[r[i].lump] == patch)
+          {
+            Z_ChangeTag(r[i].raster, PU_CACHE);   // mark recently used
+            return r[i].raster;
+          }
+        Z_Free(r[i].raster);                      // stale
+        break;
+      }
+
+  // not found: only patches which are lumps are cached, so find which
+  // before anything is evicted for it, remembering a patch which is not
+
+  if (patch == notlump[set])
+    return NULL;
+  for (lump = numlumps; --lump >= 0 && lumpcache[lump] != patch; )
+    ;
+  if (lump < 0)
+    {
+      notlump[set] = patch;
+      return NULL;
+    }
+
+  // reuse a purged way, or each in turn
+
+  if (i == RASTERWAYS)
+    for (i = 0; i < RASTERWAYS && r[i].raster; i++)
+      ;
+  if (i == RASTERWAYS)
+    {
+      Z_Free(r[i = nextway[set]].raster);
+      nextway[set] = (i+1) % RASTERWAYS;
+    }
+  r += i;
+
+  r->patch = patch;
+  r->outr = outr;
+  r->flip = flip;
+  r->lump = lump;
+  return V_RasterizePatch(patch, outr, flip, (void **) &r->raster);
+}
+
+static void V_DrawRaster(const byte *raster, byte *desttop)
+{
+  const rasterhead_t *head = (const rasterhead_t *) raster;
+  const unsigned short *spans =
+    (const unsigned short *)(raster + sizeof *head + head->extra);
+  const byte *pix = (const byte *)(spans + head->nshorts);
+  int h;
+
+  for (h = head->height; h > 0; h--, desttop += SCREENWIDTH)
+    {
+      int runs = *spans++;
+      for (; runs > 0; runs--, spans += 2)
+        {
+          memcpy(desttop + spans[0], pix, spans[1]);
+          pix += spans[1];
+        }
+    }
+}
+
+//
+// Overlays
+//
+// Several patches drawn together into one raster, for things such as
+// lines of HUD text, which are drawn the same way frame after frame. The
+// patches go in between V_BeginOverlay and V_EndOverlay, and the overlay
+// is then drawn in one pass with V_DrawOverlay, as often as wanted.
+//
+
+static int overlaybox[4];
+
+void V_BeginOverlay(void)
+{
+  M_ClearBox(overlaybox);
+}
+
+// Adds a patch to the overlay, as V_DrawPatchTranslated would draw it.
+// outr may be NULL for no translation.
+
+void V_OverlayPatch(int x, int y, patch_t *patch, const char *outr)
+{
+  int rows;
+
+  y -= SHORT(patch->topoffset);
+  x -= SHORT(patch->leftoffset);
+
+  if (x<0
+      ||x+SHORT(patch->width) >SCREENWIDTH
+      || y<0
+      || y+SHORT(patch->height)>SCREENHEIGHT)
+    return;               // as V_DrawPatch does with RANGECHECK
+
+  if ((rows = V_PatchRows(patch)) > SCREENHEIGHT - y)
+    rows = SCREENHEIGHT - y;
+  V_MaskPatch(patch, y*SCREENWIDTH + x, SCREENWIDTH, rows, outr, false);
+
+  if (SHORT(patch->width) && rows)
+    {
+      M_AddToBox(overlaybox, x, y);
+      M_AddToBox(overlaybox, x+SHORT(patch->width)-1, y+rows-1);
+    }
+}
+
+// Makes the overlay, in a purgable block owned by *user, with extra
+// bytes of room for the caller, found by V_OverlayData.
+
+byte *V_EndOverlay(size_t extra, void **user)
+{
+  rasterhead_t *head;
+  int x = 0, y = 0, width = 0, height = 0;
+
+  if (overlaybox[BOXRIGHT] >= overlaybox[BOXLEFT])
+    {
+      x = overlaybox[BOXLEFT];
+      y = overlaybox[BOXBOTTOM];      // M_AddToBox's bottom is the least y
+      width = overlaybox[BOXRIGHT] - x + 1;
+      height = overlaybox[BOXTOP] - y + 1;
+    }
+
+  head = (rasterhead_t *) V_EncodeRaster(y*SCREENWIDTH + x, SCREENWIDTH,
+                                         width, height, extra, user);
+  head->x = x;
+  head->y = y;
+
+  for (; height > 0; height--, y++)     // clear only the box marked
+    memset(rastermask + y*SCREENWIDTH + x, 0, width);
+
+  return (byte *) head;
+}
+
+void *V_OverlayData(byte *overlay)
+{
+  return overlay + sizeof(rasterhead_t);
+}
+
+void V_DrawOverlay(const byte *overlay, int scrn)
+{
+  const rasterhead_t *head = (const rasterhead_t *) overlay;
+
+  if (!scrn && head->height)
+    V_MarkRect(head->x, head->y, head->width, head->height);
+  V_DrawRaster(overlay, screens[scrn] + head->y*SCREENWIDTH + head->x);
+}
+
 //
 // V_DrawPatch
 //
@@ -262,6 +585,7 @@ void V_DrawPatch(int x, int y, int scrn, patch_t *patch)
   column_t *column;
   byte     *desttop;
   int      w;
+  const byte *raster;
 
   y -= SHORT(patch->topoffset);
   x -= SHORT(patch->leftoffset);
@@ -281,6 +605,12 @@ void V_DrawPatch(int x, int y, int scrn, patch_t *patch)
   col = 0;
   desttop = screens[scrn]+y*SCREENWIDTH+x;
 
+  if ((raster = V_PatchRaster(patch, NULL, false)))
+    {
+      V_DrawRaster(raster, desttop);
+      return;
+    }
+
   w = SHORT(patch->width);
 
   for ( ; col<w ; x++, col++, desttop++)
@@ -344,6 +674,7 @@ void V_DrawPatchTranslated(int x, int y, int scrn, patch_t *patch,
   column_t *column;
   byte     *desttop;
   int      w;
+  const byte *raster;
 
   //jff 2/18/98 if translation not needed, just use the old routine
   if (outr==cr_red)
@@ -370,6 +701,12 @@ void V_DrawPatchTranslated(int x, int y, int scrn, patch_t *patch,
   col = 0;
   desttop = screens[scrn]+y*SCREENWIDTH+x;
 
+  if ((raster = V_PatchRaster(patch, outr, false)))
+    {
+      V_DrawRaster(raster, desttop);
+      return;
+    }
+
   w = SHORT(patch->width);
   for ( ; col<w ; x++, col++, desttop++)
     {
@@ -440,6 +777,7 @@ void V_DrawPatchFlipped(int x, int y, int scrn, patch_t *patch)
   byte     *dest;
   byte     *source;
   int      w;
+  const byte *raster;
 
   y -= SHORT(patch->topoffset);
   x -= SHORT(patch->leftoffset);
@@ -461,6 +799,12 @@ void V_DrawPatchFlipped(int x, int y, int scrn, patch_t *patch)
   col = 0;
   desttop = screens[scrn]+y*SCREENWIDTH+x;
 
+  if ((raster = V_PatchRaster(patch, NULL, true)))
+    {
+      V_DrawRaster(raster, desttop);
+      return;
+    }
+
   w = SHORT(patch->width);
 
   for ( ; col<w ; x++, col++, desttop++)
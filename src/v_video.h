@@ -115,6 +115,14 @@ void V_GetBlock(int x, int y, int scrn, int width, int height, byte *dest);
 
 void V_MarkRect(int x, int y, int width,int height);
 
+// Overlays: patches drawn together once, then drawn as one, many times.
+
+void V_BeginOverlay(void);
+void V_OverlayPatch(int x, int y, patch_t *patch, const char *outr);
+byte *V_EndOverlay(size_t extra, void **user);
+void *V_OverlayData(byte *overlay);
+void V_DrawOverlay(const byte *overlay, int scrn);
+
 #endif
 
 //----------------------------------------------------------------------------
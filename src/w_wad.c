@@ -463,9 +463,15 @@ void *W_CacheLumpNum (int lump, int tag)
 #endif
 
   if (!lumpcache[lump])      // read the lump in
-    W_ReadLump(lump, Z_Malloc(W_LumpLength(lump), tag, &lumpcache[lump]));
+    {
+      zone_cache_stats.misses++;
+      W_ReadLump(lump, Z_Malloc(W_LumpLength(lump), tag, &lumpcache[lump]));
+    }
   else
-    Z_ChangeTag(lumpcache[lump],tag);
+    {
+      zone_cache_stats.hits++;
+      Z_ChangeTag(lumpcache[lump],tag);  // also marks it recently used
+    }
 
   return lumpcache[lump];
 }
@@ -39,6 +39,7 @@ static const char rcsid[] = "$Id: z_zone.c,v 1.13 1998/05/12 06:11:55 killough E
 
 #include "z_zone.h"
 #include "doomstat.h"
+#include "lprintf.h"
 
 #ifdef DJGPP
 #include <dpmi.h>
@@ -62,8 +63,12 @@ static const char rcsid[] = "$Id: z_zone.c,v 1.13 1998/05/12 06:11:55 killough E
 // Alignment of zone memory (benefit may be negated by HEADER_SIZE, CHUNK_SIZE)
 #define CACHE_ALIGN 32
 
-// size of block header
+// size of block header (twice that for the INSTRUMENTED fields)
+#ifdef INSTRUMENTED
+#define HEADER_SIZE 64
+#else
 #define HEADER_SIZE 32
+#endif
 
 // Minimum chunk size at which blocks are allocated
 #define CHUNK_SIZE 32
@@ -80,12 +85,31 @@ static const char rcsid[] = "$Id: z_zone.c,v 1.13 1998/05/12 06:11:55 killough E
 // Amount to subtract when retrying failed attempts to allocate initial pool
 #define RETRY_AMOUNT (256*1024)
 
+// Minimum size of the arenas added when the zone runs out of room
+#define ARENA_SIZE (2*1024*1024)
+
+// Free lists per power of two of block size, log2 (must be 1..5)
+#define SL_LOG2 3
+
 // signature for block header
 #define ZONEID  0x931d4a11
 
 // Number of mallocs & frees kept in history buffer (must be a power of 2)
 #define ZONE_HISTORY 4
 
+// Number of Z_Malloc call sites tracked (must be a power of 2, <= 65536)
+#define ZONE_SITES 1024
+
+// Most purgable blocks evicted to make room for one block before the
+// zone is grown by another arena instead
+#define MAX_EVICTIONS 16
+
+// Bytes of zone represented by each character of the zone map
+#define MAP_CELL 4096
+
+// Characters per line of the zone map
+#define MAP_WIDTH 64
+
 // End Tunables
 
 typedef struct memblock {
@@ -97,7 +121,11 @@ typedef struct memblock {
   struct memblock *next,*prev;
   size_t size;
   void **user;
-  unsigned char tag,vm;
+  struct memblock *lru_next,*lru_prev;  // purgable blocks, most recent first
+                                        // free blocks, in their size class
+  unsigned tag:8, vm:1;
+  unsigned first:1;                     // first block of an arena
+  unsigned site:16;                     // Z_Malloc call site, for statistics
 
 #ifdef INSTRUMENTED
   unsigned short extra;
@@ -107,12 +135,298 @@ typedef struct memblock {
 
 } memblock_t;
 
-static memblock_t *rover;                // roving pointer to memory blocks
+// The zone is made of one or more arenas, each a separately allocated
+// chunk of system memory. All their blocks form a single ring, starting
+// with the base arena allocated by Z_Init; blocks only merge with their
+// neighbours in the same arena.
+
+typedef struct arena {
+  struct arena *next;
+  memblock_t *block;                    // first block in the arena
+  size_t size;                          // allocated size
+} arena_t;
+
 static memblock_t *zone;                 // pointer to first block
-static memblock_t *zonebase;             // pointer to entire zone memory
-static size_t zonebase_size;             // zone memory allocated size
+static arena_t *arenas;                  // all arenas, newest first
 static memblock_t *blockbytag[PU_MAX];
 
+// Free blocks are kept in segregated lists, TLSF style: the first level
+// is the power of two of the block size, the second level splits each
+// power of two linearly in 1<<SL_LOG2 classes. Bitmaps of non-empty
+// lists make both insertion and search constant time.
+
+#define FL_COUNT 32
+
+static memblock_t *freelist[FL_COUNT][1<<SL_LOG2];
+static unsigned fl_bitmap;
+static unsigned sl_bitmap[FL_COUNT];
+
+#ifdef DJGPP
+
+// Index of the highest and lowest set bits, using x86 bsr and bsf
+
+__inline__ static int Z_HighBit(unsigned n)
+{
+  int r;
+  asm(" bsrl %1,%0" : "=r" (r) : "rm" (n) : "%cc");
+  return r;
+}
+
+__inline__ static int Z_LowBit(unsigned n)
+{
+  int r;
+  asm(" bsfl %1,%0" : "=r" (r) : "rm" (n) : "%cc");
+  return r;
+}
+
+#else // DJGPP
+
+static int Z_HighBit(unsigned n)
+{
+  int r = 0;
+  while (n >>= 1)
+    r++;
+  return r;
+}
+
+static int Z_LowBit(unsigned n)
+{
+  return Z_HighBit(n & -n);
+}
+
+#endif // DJGPP
+
+// Size class of a block size; sizes are at least CHUNK_SIZE
+
+static void Z_Mapping(size_t size, int *fl, int *sl)
+{
+  *fl = Z_HighBit(size);
+  *sl = (size >> (*fl - SL_LOG2)) & ((1<<SL_LOG2)-1);
+}
+
+static void Z_InsertFree(memblock_t *block)
+{
+  int fl, sl;
+  Z_Mapping(block->size, &fl, &sl);
+  if ((block->lru_next = freelist[fl][sl]))
+    block->lru_next->lru_prev = block;
+  block->lru_prev = NULL;
+  freelist[fl][sl] = block;
+  fl_bitmap |= 1u << fl;
+  sl_bitmap[fl] |= 1u << sl;
+}
+
+static void Z_RemoveFree(memblock_t *block)
+{
+  int fl, sl;
+  Z_Mapping(block->size, &fl, &sl);
+  if (block->lru_next)
+    block->lru_next->lru_prev = block->lru_prev;
+  if (block->lru_prev)
+    block->lru_prev->lru_next = block->lru_next;
+  else
+    if (!(freelist[fl][sl] = block->lru_next) &&
+        !(sl_bitmap[fl] &= ~(1u << sl)))
+      fl_bitmap &= ~(1u << fl);
+}
+
+// Find a free block of at least size bytes, or return NULL. The size is
+// rounded up to the next class first, so any block in it is big enough.
+
+static memblock_t *Z_FindFree(size_t size)
+{
+  unsigned bits;
+  int fl, sl;
+
+  size += (1 << (Z_HighBit(size) - SL_LOG2)) - 1;
+  Z_Mapping(size, &fl, &sl);
+
+  if (fl >= FL_COUNT)
+    return NULL;
+
+  if (!(bits = sl_bitmap[fl] & (~0u << sl)))
+    {
+      if (fl+1 >= FL_COUNT || !(bits = fl_bitmap & (~0u << (fl+1))))
+        return NULL;
+      bits = sl_bitmap[fl = Z_LowBit(bits)];
+    }
+
+  return freelist[fl][Z_LowBit(bits)];
+}
+
+// Purgable blocks are kept on a circular LRU list headed by cachelru:
+// cachelru.lru_next is the most recently used block, cachelru.lru_prev
+// the least recently used one, which is the first to be evicted.
+
+static memblock_t cachelru;
+
+int zone_cache_budget;                   // purgable memory budget in KB, 0=none
+zone_cache_stats_t zone_cache_stats;
+
+// Live memory accounting, always on since it costs a few additions per
+// call: bytes and blocks per tag and per Z_Malloc call site, and peaks
+// since the current level was started.
+
+typedef struct {
+  size_t bytes, peak;                    // live bytes, level peak
+  unsigned long count;                   // live blocks
+} zone_usage_t;
+
+typedef struct {
+  const char *file;
+  int line;
+  zone_usage_t usage;
+  unsigned long allocs;                  // total Z_Malloc calls
+} zone_site_t;
+
+static zone_usage_t tagusage[PU_MAX];
+static zone_usage_t totalusage;
+static zone_site_t sites[ZONE_SITES];    // hashed on file and line
+
+static const char *const tagnames[PU_MAX] = {
+  "free", "static", "sound", "music", "level", "levspec", "cache"
+};
+
+static void Z_AddUsage(zone_usage_t *u, size_t n)
+{
+  u->count++;
+  if ((u->bytes += n) > u->peak)
+    u->peak = u->bytes;
+}
+
+static void Z_SubUsage(zone_usage_t *u, size_t n)
+{
+  u->count--;
+  u->bytes -= n;
+}
+
+// Bytes a block makes available to its owner
+
+static size_t Z_BlockBytes(const memblock_t *block)
+{
+  return block->vm ? block->size - HEADER_SIZE : block->size;
+}
+
+// Find the statistics slot of a call site. Sites are hashed by their file
+// name pointer, which __FILE__ makes unique per source file. Slot 0 gets
+// everything once the table fills up.
+
+static unsigned Z_Site(const char *file, int line)
+{
+  unsigned i = ((unsigned) (size_t) file ^ line * 2654435761u) >> 4, n;
+
+  for (n = 0; n < ZONE_SITES; n++, i++)
+    {
+      zone_site_t *site = &sites[i &= ZONE_SITES-1];
+      if (!i)
+        continue;
+      if (!site->file)
+        {
+          site->file = file;
+          site->line = line;
+        }
+      if (site->file == file && site->line == line)
+        return i;
+    }
+  return 0;
+}
+
+static void Z_Account(memblock_t *block, const char *file, int line)
+{
+  size_t n = Z_BlockBytes(block);
+  zone_site_t *site = &sites[block->site = Z_Site(file, line)];
+  site->allocs++;
+  Z_AddUsage(&site->usage, n);
+  Z_AddUsage(&tagusage[block->tag], n);
+  Z_AddUsage(&totalusage, n);
+}
+
+static void Z_Unaccount(memblock_t *block)
+{
+  size_t n = Z_BlockBytes(block);
+  Z_SubUsage(&sites[block->site].usage, n);
+  Z_SubUsage(&tagusage[block->tag], n);
+  Z_SubUsage(&totalusage, n);
+}
+
+// Start new peaks, once the previous level's memory has been freed
+
+static void Z_ResetPeaks(void)
+{
+  int i;
+  for (i = 0; i < PU_MAX; i++)
+    tagusage[i].peak = tagusage[i].bytes;
+  for (i = 0; i < ZONE_SITES; i++)
+    sites[i].usage.peak = sites[i].usage.bytes;
+  totalusage.peak = totalusage.bytes;
+}
+
+static void Z_CacheLink(memblock_t *block)
+{
+  (block->lru_next = cachelru.lru_next)->lru_prev = block;
+  (block->lru_prev = &cachelru)->lru_next = block;
+  if ((zone_cache_stats.bytes += block->size) > zone_cache_stats.peak)
+    zone_cache_stats.peak = zone_cache_stats.bytes;
+}
+
+static void Z_CacheUnlink(memblock_t *block)
+{
+  (block->lru_prev->lru_next = block->lru_next)->lru_prev = block->lru_prev;
+  zone_cache_stats.bytes -= block->size;
+}
+
+// Free a block in the zone and return the free block it was merged into
+
+static memblock_t *Z_FreeMerged(memblock_t *block, const char *file, int line)
+{
+  memblock_t *prev = block->prev;
+  (Z_Free)((char *) block + HEADER_SIZE, file, line);
+  return !block->first && prev->tag == PU_FREE ? prev : block;
+}
+
+// Evict the least recently used purgable block which lives in the zone,
+// and return the free block it was merged into, or NULL if there is none.
+
+static memblock_t *Z_EvictOldest(const char *file, int line)
+{
+  memblock_t *block;
+  for (block = cachelru.lru_prev; block != &cachelru; block = block->lru_prev)
+    if (!block->vm)
+      {
+        zone_cache_stats.evictions++;
+        return Z_FreeMerged(block, file, line);
+      }
+  return NULL;
+}
+
+// Evict least recently used blocks until size more bytes of purgable
+// memory fit in the configured budget.
+
+static void Z_TrimCache(size_t size, const char *file, int line)
+{
+  size_t budget = (size_t) zone_cache_budget * 1024;
+  if (budget)
+    while (zone_cache_stats.bytes + size > budget &&
+           cachelru.lru_prev != &cachelru)
+      {
+        zone_cache_stats.evictions++;
+        (Z_Free)((char *) cachelru.lru_prev + HEADER_SIZE, file, line);
+      }
+}
+
+void Z_PrintCacheStats(void)
+{
+  unsigned long lookups = zone_cache_stats.hits + zone_cache_stats.misses;
+  lprintf(LO_INFO, "Cache: %lu hits, %lu misses (%.1f%% hit rate), "
+          "%lu evictions\n"
+          "Cache: %lu bytes purgable, %lu peak, budget %dK\n",
+          zone_cache_stats.hits, zone_cache_stats.misses,
+          lookups ? 100.0 * zone_cache_stats.hits / lookups : 0.0,
+          zone_cache_stats.evictions,
+          (unsigned long) zone_cache_stats.bytes,
+          (unsigned long) zone_cache_stats.peak, zone_cache_budget);
+}
+
 #ifdef INSTRUMENTED
 
 // statistics for evaluating performance
@@ -190,10 +504,114 @@ void Z_DumpHistory(char *buf)
 
 #endif
 
+// Add an arena of at least size bytes to the end of the zone and
+// return its single free block, or NULL if the system is out of memory.
+
+static memblock_t *Z_AddArena(size_t size)
+{
+  arena_t *arena;
+  memblock_t *block;
+  size_t total;
+
+  size = (size+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);  // round to chunk size
+
+  if (!(arena = (malloc)(total = sizeof *arena + CACHE_ALIGN +
+                         HEADER_SIZE + size)))
+    return NULL;
+
+  // Align first block on cache boundary
+
+  block = (memblock_t *) ((char *) arena + sizeof *arena + CACHE_ALIGN -
+                          ((unsigned) ((char *) arena + sizeof *arena) &
+                           (CACHE_ALIGN-1)));
+
+  arena->block = block;
+  arena->size = total;
+  arena->next = arenas;
+  arenas = arena;
+
+  if (!zone)                              // First arena is the base of zone
+    zone = block->next = block->prev = block;
+  else
+    {                                     // Others go at the end of the ring
+      (block->prev = zone->prev)->next = block;
+      (block->next = zone)->prev = block;
+    }
+
+  block->size = size;                     // All memory in one block
+  block->tag = PU_FREE;                   // A free block
+  block->vm  = 0;
+  block->first = 1;                       // Never merged with previous block
+
+#ifdef ZONEIDCHECK
+  block->id  = 0;
+#endif
+
+  Z_InsertFree(block);
+
+#ifdef INSTRUMENTED
+  free_memory += size;
+  inactive_memory += total - size;
+#endif
+
+  return block;
+}
+
+// Return arenas other than the base one to the system, once everything
+// in them is free or purgable. Called whenever level memory is released.
+
+static void Z_ReleaseArenas(const char *file, int line)
+{
+  arena_t **p = &arenas, *arena;
+
+  while ((arena = *p))
+    {
+      memblock_t *block = arena->block;
+      boolean inuse = block == zone;      // Keep the base arena
+
+      if (!inuse)
+        do                                // Anything still in use here?
+          inuse = block->tag != PU_FREE && block->tag < PU_PURGELEVEL;
+        while (!inuse && !(block = block->next)->first);
+
+      if (inuse)
+        {
+          p = &arena->next;
+          continue;
+        }
+
+      block = arena->block;               // Purge what is left in cache
+      do
+        if (block->tag >= PU_PURGELEVEL)
+          {
+            zone_cache_stats.evictions++;
+            block = Z_FreeMerged(block, file, line);
+          }
+      while (!(block = block->next)->first);
+
+      block = arena->block;               // Now a single free block
+      Z_RemoveFree(block);
+      (block->prev->next = block->next)->prev = block->prev;
+
+#ifdef INSTRUMENTED
+      free_memory -= block->size;
+      inactive_memory -= arena->size - block->size;
+#endif
+
+      *p = arena->next;
+      (free)(arena);
+    }
+}
+
 static void Z_Close(void)
 {
-  (free)(zonebase);
-  zone = rover = zonebase = NULL;
+  while (arenas)
+    {
+      arena_t *arena = arenas;
+      arenas = arena->next;
+      (free)(arena);
+    }
+  zone = NULL;
 }
 
 void Z_Init(void)
@@ -213,38 +631,17 @@ void Z_Init(void)
 
   atexit(Z_Close);            // exit handler
 
-  size = (size+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);  // round to chunk size
+  cachelru.lru_next = cachelru.lru_prev = &cachelru;   // Empty LRU list
 
-   // Allocate the memory
+   // Allocate the base arena; more are added as the zone fills up
 
-  while (!(zonebase=(malloc)(zonebase_size=size + HEADER_SIZE + CACHE_ALIGN)))
+  while (!Z_AddArena(size))
     if (size < (MIN_RAM-LEAVE_ASIDE < RETRY_AMOUNT ? RETRY_AMOUNT :
                                                      MIN_RAM-LEAVE_ASIDE))
       I_Error("Z_Init: failed on allocation of %lu bytes",(unsigned long)
-              zonebase_size);
+              size);
     else
       size -= RETRY_AMOUNT;
-
-  // Align on cache boundary
-
-  zone = (memblock_t *) ((char *) zonebase + CACHE_ALIGN -
-                         ((unsigned) zonebase & (CACHE_ALIGN-1)));
-
-  rover = zone;                            // Rover points to base of zone mem
-  zone->next = zone->prev = zone;          // Single node
-  zone->size = size;                       // All memory in one block
-  zone->tag = PU_FREE;                     // A free block
-  zone->vm  = 0;
-
-#ifdef ZONEIDCHECK
-  zone->id  = 0;
-#endif
-
-#ifdef INSTRUMENTED
-  free_memory = size;
-  inactive_memory = zonebase_size - size;
-  active_memory = purgable_memory = 0;
-#endif
 }
 
 // Z_Malloc
@@ -253,7 +650,6 @@ void Z_Init(void)
 void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
 {
   register memblock_t *block;
-  memblock_t *start;
 
 #ifdef INSTRUMENTED
   size_t size_orig = size;
@@ -277,79 +673,93 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
 
   size = (size+CHUNK_SIZE-1) & ~(CHUNK_SIZE-1);  // round to chunk size
 
-  block = rover;
+  // Keep purgable memory within budget before looking for space
 
-  if (block->prev->tag == PU_FREE)
-    block = block->prev;
+  Z_TrimCache(tag >= PU_PURGELEVEL ? size : 0, file, line);
 
-  start = block;
+  // Good fit among free blocks only. Purgable blocks are left alone
+  // here, and are only evicted below, least recently used first, a few
+  // at most before the zone is grown, so that one allocation neither
+  // empties the cache nor takes unbounded time.
 
-  do
+  if (!(block = Z_FindFree(size)))
     {
-      if (block->tag >= PU_PURGELEVEL)      // Free purgable blocks
-        {                                   // replacement is roughly FIFO
-          start = block->prev;
-          Z_Free((char *) block + HEADER_SIZE);
-          block = start = start->next;      // Important: resets start
-        }
+      int n = MAX_EVICTIONS;
+      while (n-- && (block = Z_EvictOldest(file, line)) && block->size < size)
+        ;
+      if (block && block->size < size)
+        block = NULL;
+    }
 
-      if (block->tag == PU_FREE && block->size >= size)   // First-fit
-        {
-          size_t extra = block->size - size;
-          if (extra >= MIN_BLOCK_SPLIT + HEADER_SIZE)
-            {
-              memblock_t *newb = (memblock_t *)((char *) block +
-                                                HEADER_SIZE + size);
+  if (!block)                  // Grow the zone by another arena
+    block = Z_AddArena(size < ARENA_SIZE ? ARENA_SIZE : size);
 
-              (newb->next = block->next)->prev = newb;
-              (newb->prev = block)->next = newb;          // Split up block
-              block->size = size;
-              newb->size = extra - HEADER_SIZE;
-              newb->tag = PU_FREE;
-              newb->vm = 0;
+  if (!block)                  // No more system memory; empty the cache
+    while ((block = Z_EvictOldest(file, line)) && block->size < size)
+      ;
+
+  if (block)
+    {
+      size_t extra = block->size - size;
+
+      Z_RemoveFree(block);
+
+
+      if (extra >= MIN_BLOCK_SPLIT + HEADER_SIZE)
+        {
+          memblock_t *newb = (memblock_t *)((char *) block +
+                                            HEADER_SIZE + size);
+
+          (newb->next = block->next)->prev = newb;
+          (newb->prev = block)->next = newb;          // Split up block
+          block->size = size;
+          newb->size = extra - HEADER_SIZE;
+          newb->tag = PU_FREE;
+          newb->vm = 0;
+          newb->first = 0;
+          Z_InsertFree(newb);
 
 #ifdef INSTRUMENTED
-              inactive_memory += HEADER_SIZE;
-              free_memory -= HEADER_SIZE;
+          inactive_memory += HEADER_SIZE;
+          free_memory -= HEADER_SIZE;
 #endif
-            }
-
-          rover = block->next;           // set roving pointer for next search
+        }
 
 #ifdef INSTRUMENTED
-          inactive_memory += block->extra = block->size - size_orig;
-          if (tag >= PU_PURGELEVEL)
-            purgable_memory += size_orig;
-          else
-            active_memory += size_orig;
-          free_memory -= block->size;
+      inactive_memory += block->extra = block->size - size_orig;
+      if (tag >= PU_PURGELEVEL)
+        purgable_memory += size_orig;
+      else
+        active_memory += size_orig;
+      free_memory -= block->size;
 #endif
 
 allocated:
 
 #ifdef INSTRUMENTED
-          block->file = file;
-          block->line = line;
+      block->file = file;
+      block->line = line;
 #endif
 
 #ifdef ZONEIDCHECK
-          block->id = ZONEID;         // signature required in block header
+      block->id = ZONEID;         // signature required in block header
 #endif
-          block->tag = tag;           // tag
-          block->user = user;         // user
-          block = (memblock_t *)((char *) block + HEADER_SIZE);
-          if (user)                   // if there is a user
-            *user = block;            // set user to point to new block
+      block->tag = tag;           // tag
+      block->user = user;         // user
+      Z_Account(block, file, line);
+      if (tag >= PU_PURGELEVEL)   // newest block in the cache
+        Z_CacheLink(block);
+      block = (memblock_t *)((char *) block + HEADER_SIZE);
+      if (user)                   // if there is a user
+        *user = block;            // set user to point to new block
 
 #ifdef INSTRUMENTED
-          Z_PrintStats();           // print memory allocation stats
-          // scramble memory -- weed out any bugs
-          memset(block, gametic & 0xff, size);
+      Z_PrintStats();           // print memory allocation stats
+      // scramble memory -- weed out any bugs
+      memset(block, gametic & 0xff, size);
 #endif
-          return block;
-        }
+      return block;
     }
-  while ((block = block->next) != start);   // detect cycles as failure
 
   // We've run out of physical memory, or so we think.
   // Although less efficient, we'll just use ordinary malloc.
@@ -369,9 +779,11 @@ allocated:
   blockbytag[tag] = block;
   block->prev = (memblock_t *) &blockbytag[tag];
   block->vm = 1;
+  block->first = 0;
+  block->size = size + HEADER_SIZE;
 
 #ifdef INSTRUMENTED
-  virtual_memory += block->size = size + HEADER_SIZE;
+  virtual_memory += block->size;
 #endif
 
   goto allocated;
@@ -407,6 +819,8 @@ void (Z_Free)(void *p, const char *file, int line)
       block->id = 0;              // Nullify id so another free fails
 #endif
 
+      Z_Unaccount(block);
+
 #ifdef INSTRUMENTED
       // scramble memory -- weed out any bugs
       memset(p, gametic & 0xff, block->size - block->extra);
@@ -415,6 +829,9 @@ void (Z_Free)(void *p, const char *file, int line)
       if (block->user)            // Nullify user if one exists
         *block->user = NULL;
 
+      if (block->tag >= PU_PURGELEVEL)
+        Z_CacheUnlink(block);
+
       if (block->vm)
         {
           if ((*(memblock_t **) block->prev = block->next))
@@ -439,13 +856,12 @@ void (Z_Free)(void *p, const char *file, int line)
 
           block->tag = PU_FREE;       // Mark block freed
 
-          if (block != zone)
+          if (!block->first)
             {
               other = block->prev;        // Possibly merge with previous block
               if (other->tag == PU_FREE)
                 {
-                  if (rover == block)  // Move back rover if it points at block
-                    rover = other;
+                  Z_RemoveFree(other);
                   (other->next = block->next)->prev = other;
                   other->size += block->size + HEADER_SIZE;
                   block = other;
@@ -458,10 +874,9 @@ void (Z_Free)(void *p, const char *file, int line)
             }
 
           other = block->next;        // Possibly merge with next block
-          if (other->tag == PU_FREE && other != zone)
+          if (other->tag == PU_FREE && !other->first)
             {
-              if (rover == other) // Move back rover if it points at next block
-                rover = block;
+              Z_RemoveFree(other);
               (block->next = other->next)->prev = block;
               block->size += other->size + HEADER_SIZE;
 
@@ -470,6 +885,8 @@ void (Z_Free)(void *p, const char *file, int line)
               free_memory += HEADER_SIZE;
 #endif
             }
+
+          Z_InsertFree(block);
         }
 
 #ifdef INSTRUMENTED
@@ -481,6 +898,7 @@ void (Z_Free)(void *p, const char *file, int line)
 void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
 {
   memblock_t *block = zone;
+  boolean level = lowtag <= PU_LEVEL && hightag >= PU_LEVEL;
 
   if (lowtag <= PU_FREE)
     lowtag = PU_FREE+1;
@@ -525,10 +943,21 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
         if (block->user)            // Nullify user if one exists
           *block->user = NULL;
 
+        if (block->tag >= PU_PURGELEVEL)
+          Z_CacheUnlink(block);
+
+        Z_Unaccount(block);
+
         (free)(block);              // Free the block
 
         block = next;               // Advance to next block
       }
+
+  if (level)                        // Level memory is gone, shrink the zone
+    {
+      Z_ReleaseArenas(file, line);
+      Z_ResetPeaks();
+    }
 }
 
 void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
@@ -567,6 +996,15 @@ void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
 
 #endif // ZONEIDCHECK
 
+  // Purgable blocks move to the head of the LRU list whenever they are
+  // retagged, which is how W_CacheLumpNum marks a lump as recently used.
+
+  if (block->tag >= PU_PURGELEVEL)
+    Z_CacheUnlink(block);
+
+  Z_SubUsage(&tagusage[block->tag], Z_BlockBytes(block));
+  Z_AddUsage(&tagusage[tag], Z_BlockBytes(block));
+
   if (block->vm)
     {
       if ((*(memblock_t **) block->prev = block->next))
@@ -592,7 +1030,8 @@ void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
           }
 #endif
     }
-  block->tag = tag;
+  if ((block->tag = tag) >= PU_PURGELEVEL)
+    Z_CacheLink(block);
 }
 
 void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user,
@@ -626,8 +1065,8 @@ char *(Z_Strdup)(const char *s, int tag, void **user,
 void (Z_CheckHeap)(const char *file, int line)
 {
   memblock_t *block = zone;   // Start at base of zone mem
-  do                          // Consistency check (last node treated special)
-    if ((block->next != zone &&
+  do                          // Consistency check (arena ends treated special)
+    if ((!block->next->first &&
          (memblock_t *)((char *) block+HEADER_SIZE+block->size) != block->next)
         || block->next->prev != block || block->prev->next != block)
       I_Error("Z_CheckHeap: Block size does not touch the next block\n"
@@ -642,6 +1081,109 @@ void (Z_CheckHeap)(const char *file, int line)
   while ((block=block->next) != zone);
 }
 
+// Write memory usage per tag and per call site, level peaks and a map
+// of the zone's block layout to a text file. Returns 0 on failure.
+
+int Z_DumpStats(const char *filename)
+{
+  static const char mapchars[PU_MAX] = {'.','S','s','m','L','l','c'};
+  size_t freebytes = 0, largest = 0;
+  unsigned long freeblocks = 0;
+  memblock_t *block;
+  arena_t *arena;
+  int i, n;
+  FILE *fp;
+
+  if (!(fp = fopen(filename, "w")))
+    return 0;
+
+  block = zone;
+  do
+    if (block->tag == PU_FREE)
+      {
+        freeblocks++;
+        freebytes += block->size;
+        if (block->size > largest)
+          largest = block->size;
+      }
+  while ((block = block->next) != zone);
+
+  fprintf(fp, "Zone memory: %lu bytes live in %lu blocks, level peak %lu\n"
+          "Free: %lu bytes in %lu blocks, largest %lu, fragmentation %.1f%%\n"
+          "Cache: %lu hits, %lu misses, %lu evictions\n"
+          "\n%-8s %10s %10s %8s\n",
+          (unsigned long) totalusage.bytes, totalusage.count,
+          (unsigned long) totalusage.peak,
+          (unsigned long) freebytes, freeblocks, (unsigned long) largest,
+          freebytes ? 100.0 - 100.0 * largest / freebytes : 0.0,
+          zone_cache_stats.hits, zone_cache_stats.misses,
+          zone_cache_stats.evictions,
+          "Tag", "Live", "Peak", "Blocks");
+
+  for (i = PU_FREE+1; i < PU_MAX; i++)
+    fprintf(fp, "%-8s %10lu %10lu %8lu\n", tagnames[i],
+            (unsigned long) tagusage[i].bytes,
+            (unsigned long) tagusage[i].peak, tagusage[i].count);
+
+  fprintf(fp, "\n%-24s %10s %10s %8s %10s\n",
+          "Call site", "Live", "Peak", "Blocks", "Mallocs");
+
+  for (i = 0; i < ZONE_SITES; i++)
+    if (sites[i].allocs)
+      {
+        char where[32];
+        if (sites[i].file)
+          sprintf(where, "%.20s:%d", sites[i].file, sites[i].line);
+        else
+          strcpy(where, "(other)");
+        fprintf(fp, "%-24s %10lu %10lu %8lu %10lu\n", where,
+                (unsigned long) sites[i].usage.bytes,
+                (unsigned long) sites[i].usage.peak,
+                sites[i].usage.count, sites[i].allocs);
+      }
+
+  fprintf(fp, "\nZone map, %d bytes per character:\n", MAP_CELL);
+  for (i = 0; i < PU_MAX; i++)
+    fprintf(fp, " %c %s", mapchars[i], tagnames[i]);
+  fputc('\n', fp);
+
+  // Arenas in ring order, each cell showing the block at its start
+
+  block = zone;
+  do
+    {
+      char *base = (char *) block;
+      size_t size = 0;
+
+      for (arena = arenas; arena->block != block; arena = arena->next)
+        ;
+
+      do
+        size += HEADER_SIZE + block->size;
+      while (!(block = block->next)->first);
+
+      fprintf(fp, "\nArena of %lu bytes:", (unsigned long) size);
+
+      block = arena->block;
+      for (n = 0; n * MAP_CELL < size; n++)
+        {
+          while ((char *) block + HEADER_SIZE + block->size <=
+                 base + n * MAP_CELL)
+            block = block->next;
+          if (!(n % MAP_WIDTH))
+            fputc('\n', fp);
+          fputc(mapchars[block->tag], fp);
+        }
+      fputc('\n', fp);
+
+      while (!(block = block->next)->first)
+        ;
+    }
+  while (block != zone);
+
+  return !fclose(fp);
+}
+
 //-----------------------------------------------------------------------------
 //
 // $Log: z_zone.c,v $
@@ -73,6 +73,19 @@ void *(Z_Realloc)(void *p, size_t n, int tag, void **user, const char *, int);
 char *(Z_Strdup)(const char *s, int tag, void **user, const char *, int);
 void (Z_CheckHeap)(const char *,int);   // killough 3/22/98: add file/line info
 void Z_DumpHistory(char *);
+void Z_PrintCacheStats(void);
+int Z_DumpStats(const char *filename);
+
+// Purgable (PU_CACHE) block statistics. Hits and misses are counted by
+// W_CacheLumpNum, evictions by the zone whenever it purges a block.
+
+typedef struct {
+  unsigned long hits, misses, evictions;
+  size_t bytes, peak;                     // purgable memory in use
+} zone_cache_stats_t;
+
+extern zone_cache_stats_t zone_cache_stats;
+extern int zone_cache_budget;             // in KB, 0 = no limit
 
 #define Z_Free(a)          (Z_Free)     (a,      __FILE__,__LINE__)
 #define Z_FreeTags(a,b)    (Z_FreeTags) (a,b,    __FILE__,__LINE__)